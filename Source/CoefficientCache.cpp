@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    CoefficientCache.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientCache.h"
+#include "VocoderDsp.h"
+
+CoefficientTable::CoefficientTable(const Key& k) : key(k) {
+    coefficients.reserve((size_t) (key.numBands * coefficientsPerBand));
+    for (int band = 0; band < key.numBands; band++) {
+        const float centerFreq = VocoderDsp::getBandCenterFrequency(band, key.numBands, key.minFreq, key.maxFreq);
+        auto bandPass = juce::dsp::IIR::Coefficients<float>::makeBandPass(key.sampleRate, centerFreq, key.q);
+        coefficients.insert(coefficients.end(), bandPass->getRawCoefficients(), bandPass->getRawCoefficients() + coefficientsPerBand);
+    }
+}
+
+CoefficientTable::Ptr CoefficientCache::get(const CoefficientTable::Key& key) {
+    const juce::ScopedLock sl (lock);
+    for (auto* table : tables)
+        if (table->getKey() == key)
+            return table;
+
+    if (tables.size() >= capacity)
+        evictUnused();
+
+    CoefficientTable::Ptr built = new CoefficientTable(key);
+    tables.add(built);
+    return built;
+}
+
+// Every other reference is taken under the lock, so a table the array alone
+// holds cannot gain one while it is being removed.
+int CoefficientCache::evictUnused() {
+    const juce::ScopedLock sl (lock);
+    const int numBefore = tables.size();
+    for (int i = tables.size(); --i >= 0;)
+        if (tables.getObjectPointerUnchecked(i)->getReferenceCount() == 1)
+            tables.remove(i);
+    return numBefore - tables.size();
+}
+
+int CoefficientCache::getNumTables() const {
+    const juce::ScopedLock sl (lock);
+    return tables.size();
+}
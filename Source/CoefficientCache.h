@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    CoefficientCache.h
+    Process-wide cache of band-pass coefficient tables, shared by every
+    instance through a SharedResourcePointer. Tables are immutable and
+    reference counted; instances with the same band layout at the same
+    sample rate share one table.
+
+    The cache is only used off the audio thread (prepareToPlay, the preset
+    bank and the arena thread), so lookups take a lock and scan the tables;
+    with at most capacity keys to compare, the scan costs far less than
+    building the one table a miss needs. Once it holds
+    capacity tables, a miss first evicts the tables no instance references
+    any more, which keeps a parameter sweep from piling up layouts.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class CoefficientTable : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CoefficientTable>;
+
+    struct Key
+    {
+        double sampleRate = 0.0;
+        int numBands = 0;
+        float minFreq = 0.0f, maxFreq = 0.0f, q = 0.0f;
+
+        bool operator== (const Key& other) const {
+            return sampleRate == other.sampleRate && numBands == other.numBands
+                && minFreq == other.minFreq && maxFreq == other.maxFreq && q == other.q;
+        }
+    };
+
+    // Allocates.
+    explicit CoefficientTable(const Key& key);
+
+    const Key& getKey() const { return key; }
+
+    // Normalised biquad coefficients { b0, b1, b2, a1, a2 } of a band.
+    static constexpr int coefficientsPerBand = 5;
+    const float* getBand(int band) const { return coefficients.data() + band * coefficientsPerBand; }
+
+private:
+    const Key key;
+    std::vector<float> coefficients;
+};
+
+class CoefficientCache
+{
+public:
+    CoefficientCache() = default;
+
+    // The table for key, building it on a miss. Locks and may allocate, so
+    // never call it from the audio thread.
+    CoefficientTable::Ptr get(const CoefficientTable::Key& key);
+
+    // Drops every table that only the cache references; returns how many.
+    int evictUnused();
+
+    int getNumTables() const;
+
+    static constexpr int capacity = 256;
+
+private:
+    juce::CriticalSection lock;
+    juce::ReferenceCountedArray<CoefficientTable> tables;
+
+    JUCE_DECLARE_NON_COPYABLE(CoefficientCache)
+};
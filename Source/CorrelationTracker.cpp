@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    CorrelationTracker.cpp
+
+  ==============================================================================
+*/
+
+#include "CorrelationTracker.h"
+
+void CorrelationTracker::prepare(double sampleRate) {
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = 1;
+    spec.numChannels = 1;
+
+    downsampleFilter.prepare(spec);
+    downsampleFilter.coefficients = Coefficients::makeLowPass(sampleRate, maxFundamentalFreq);
+
+    maxLag = static_cast<int>(sampleRate / (minFundamentalFreq * AUTOCORRELATION_DOWNSAMPLE));
+    minLag = static_cast<int>(sampleRate / (maxFundamentalFreq * AUTOCORRELATION_DOWNSAMPLE));
+    correlationBufferSize = 2 * maxLag;
+
+    float correlationReleaseInSamples = correlationReleaseInMs * sampleRate / 1000;
+    correlationReleaseCoeff = std::exp(-1 / correlationReleaseInSamples);
+
+    float correlationAttackInSamples = correlationAttackInMs * sampleRate / 1000;
+    correlationAttackCoeff = std::exp(-1 / correlationAttackInSamples);
+}
+
+void CorrelationTracker::setStorage(float* storage) {
+    correlationBuffer = storage;
+    correlationLevels = correlationBuffer + correlationBufferSize;
+    lagEnergyLevels = correlationLevels + (maxLag - minLag + 1);
+}
+
+void CorrelationTracker::reset() {
+    downsampleFilter.reset();
+    juce::FloatVectorOperations::clear(correlationBuffer, getStorageSize());
+    correlationBufferPointer = 0;
+    currentWindowEnergyLevel = 0.0f;
+    lastCorrelation = 0.0f;
+}
+
+void CorrelationTracker::process(const float* input, float* correlationOut, int numSamples, bool enabled) {
+    float* correlationLevelsData = correlationLevels;
+    float* correlationBufferData = correlationBuffer;
+    float* lagEnergyData = lagEnergyLevels;
+
+    for (int sample = 0; sample < numSamples; sample++) {
+        float filteredSample = downsampleFilter.processSample(input[sample]);
+
+        if (enabled && (sample % AUTOCORRELATION_DOWNSAMPLE == 0)) {
+            int currentWindowEndSample = (correlationBufferPointer - (maxLag - minLag) + correlationBufferSize) % correlationBufferSize;
+            currentWindowEnergyLevel += filteredSample * filteredSample;
+            currentWindowEnergyLevel -= correlationBufferData[currentWindowEndSample] * correlationBufferData[currentWindowEndSample];
+
+            float maxCorrelation = 0;
+            for (int lag = minLag; lag <= maxLag; lag++) {
+                int lagSample = (correlationBufferPointer - lag + correlationBufferSize) % correlationBufferSize;
+                int currentWindowEndLagSample = (correlationBufferPointer - (maxLag - minLag) - lag + correlationBufferSize) % correlationBufferSize;
+                correlationLevelsData[lag - minLag] += filteredSample * correlationBufferData[lagSample];
+                correlationLevelsData[lag - minLag] -= correlationBufferData[currentWindowEndSample] * correlationBufferData[currentWindowEndLagSample];
+                lagEnergyData[lag - minLag] += correlationBufferData[lagSample] * correlationBufferData[lagSample];
+                lagEnergyData[lag - minLag] -= correlationBufferData[currentWindowEndLagSample] * correlationBufferData[currentWindowEndLagSample];
+                float energy = currentWindowEnergyLevel * lagEnergyData[lag - minLag];
+                float lagCorrelation;
+                if (energy > 1e-10f) {
+                    lagCorrelation = std::abs(correlationLevelsData[lag - minLag]) / std::sqrt(energy);
+                } else {
+                    lagCorrelation = 0.0f;
+                }
+                if (lagCorrelation > maxCorrelation) {
+                    maxCorrelation = lagCorrelation;
+                }
+            }
+
+            correlationBufferData[correlationBufferPointer] = filteredSample;
+            correlationBufferPointer = ((correlationBufferPointer + 1) % correlationBufferSize);
+
+            float correlation = std::pow(juce::jlimit(0.0f, 1.0f, (maxCorrelation - 0.5f) * 2), 2.0f);
+
+            if (correlation > lastCorrelation) {
+                lastCorrelation += (correlation - lastCorrelation) * (1 - correlationAttackCoeff);
+            } else {
+                lastCorrelation += (correlation - lastCorrelation) * (1 - correlationReleaseCoeff);
+            }
+        }
+
+        if (correlationOut != nullptr)
+            correlationOut[sample] = lastCorrelation;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    CorrelationTracker.h
+    Sliding-window normalised autocorrelation of the sidechain, used as a
+    voiced/unvoiced detector. Runs on a low-passed copy of the signal and
+    refreshes the peak over the pitch lag range every
+    AUTOCORRELATION_DOWNSAMPLE samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define AUTOCORRELATION_DOWNSAMPLE 8
+
+class CorrelationTracker
+{
+public:
+    // The windows live in caller-owned storage of getStorageSize() floats,
+    // set with setStorage() after prepare() and before anything else.
+    void prepare(double sampleRate);
+    int getStorageSize() const { return correlationBufferSize + 2 * (maxLag - minLag + 1); }
+    void setStorage(float* storage);
+    void reset();
+
+    // correlationOut, if not null, receives the smoothed correlation after
+    // every sample. The low-pass runs even when disabled so that enabling the
+    // detector does not start from a stale filter state.
+    void process(const float* input, float* correlationOut, int numSamples, bool enabled);
+
+    float getCorrelation() const { return lastCorrelation; }
+
+private:
+    using Filter = juce::dsp::IIR::Filter<float>;
+    using Coefficients = juce::dsp::IIR::Coefficients<float>;
+
+    float minFundamentalFreq = 60.0;
+    float maxFundamentalFreq = 400.0;
+
+    float correlationReleaseInMs = 5.0f;
+    float correlationAttackInMs = 5.0f;
+    float correlationAttackCoeff = 0.0f;
+    float correlationReleaseCoeff = 0.0f;
+
+    Filter downsampleFilter;
+
+    float* correlationBuffer = nullptr;
+    float* correlationLevels = nullptr;
+    float* lagEnergyLevels = nullptr;
+
+    int minLag = 0, maxLag = 0, correlationBufferSize = 0;
+    int correlationBufferPointer = 0;
+    float currentWindowEnergyLevel = 0.0f;
+    float lastCorrelation = 0.0f;
+};
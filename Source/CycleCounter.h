@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    CycleCounter.h
+    Cheap timestamp counter for profiling. Reads the TSC on x86 and the
+    virtual counter on AArch64, falling back to JUCE's high resolution ticks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+struct CycleCounter
+{
+    static inline juce::uint64 now() noexcept {
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #elif JUCE_ARM && defined (__aarch64__) && ! JUCE_MSVC
+        juce::uint64 value;
+        asm volatile ("mrs %0, cntvct_el0" : "=r" (value));
+        return value;
+       #else
+        return (juce::uint64) juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    // Counter frequency, measured once against the wall clock on first use.
+    // The measurement spins for 50 ms, so the message thread should use
+    // calibrateInBackground() and isCalibrated() instead of waiting on it.
+    static double getTicksPerSecond() {
+        static const double ticksPerSecond = [] {
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            const auto startCount = now();
+            while (juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) < 0.05) {}
+            const auto endCount = now();
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            const double measured = (double) (endCount - startCount) / elapsed;
+            calibrated().store(true);
+            return measured;
+        }();
+        return ticksPerSecond;
+    }
+
+    // Starts the measurement on a background thread, once per process.
+    static void calibrateInBackground() {
+        static const bool launched = juce::Thread::launch([] { getTicksPerSecond(); });
+        juce::ignoreUnused(launched);
+    }
+
+    // True once getTicksPerSecond() and ticksToSeconds() return without waiting.
+    static bool isCalibrated() noexcept {
+        return calibrated().load();
+    }
+
+    static double ticksToSeconds(juce::uint64 ticks) {
+        return (double) ticks / getTicksPerSecond();
+    }
+
+private:
+    static std::atomic<bool>& calibrated() noexcept {
+        static std::atomic<bool> flag { false };
+        return flag;
+    }
+};
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    DspStateArena.cpp
+
+  ==============================================================================
+*/
+
+#include "DspStateArena.h"
+
+static constexpr size_t cacheLineSize = 64;
+
+static size_t alignToCacheLine(size_t offset) {
+    return (offset + cacheLineSize - 1) & ~(cacheLineSize - 1);
+}
+
+DspStateArena::DspStateArena(const Layout& l) : layout(l) {
+    const size_t numChannels = (size_t) layout.numChannels;
+    const size_t numBands = (size_t) layout.numBands;
+
+    size_t offset = 0;
+    auto section = [&offset] (size_t bytes) {
+        const size_t start = offset;
+        offset = alignToCacheLine(offset + bytes);
+        return start;
+    };
+    stagesOffset = section(sizeof(VocoderDsp::StageState) * numChannels * numBanks * numBands * (size_t) layout.order);
+    envelopesOffset = section(sizeof(float) * numFollowers * numChannels * numBands);
+    quietOffset = section(sizeof(int) * numChannels * numBands);
+    suspendedOffset = section(sizeof(bool) * numChannels * numBands);
+    endOfFollowers = offset;
+    correlationOffset = section(sizeof(float) * numChannels * (size_t) layout.correlationSize);
+    svfOffset = section(sizeof(VocoderDsp::SvfCoefficients) * numBanks * (size_t) layout.numSvfSegments * numBands);
+    totalSize = offset;
+
+    memory.calloc(totalSize + cacheLineSize);
+    base = reinterpret_cast<char*>(alignToCacheLine(reinterpret_cast<size_t>(memory.get())));
+}
+
+void DspStateArena::clearFilterStates() noexcept {
+    std::memset(base + stagesOffset, 0, envelopesOffset - stagesOffset);
+}
+
+// Envelopes and band activity.
+void DspStateArena::clearFollowers() noexcept {
+    std::memset(base + envelopesOffset, 0, endOfFollowers - envelopesOffset);
+}
+
+void DspStateArena::copyStateFrom(DspStateArena& other) noexcept {
+    const int numChannels = juce::jmin(layout.numChannels, other.layout.numChannels);
+    const int numBands = juce::jmin(layout.numBands, other.layout.numBands);
+    const size_t stageBytes = sizeof(VocoderDsp::StageState) * (size_t) juce::jmin(layout.order, other.layout.order);
+
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (int band = 0; band < numBands; band++)
+            for (int bank = 0; bank < numBanks; bank++)
+                std::memcpy(getStages(channel, (Bank) bank, band), other.getStages(channel, (Bank) bank, band), stageBytes);
+
+        for (int follower = 0; follower < numFollowers; follower++)
+            std::memcpy(getEnvelopes((Follower) follower, channel), other.getEnvelopes((Follower) follower, channel), sizeof(float) * (size_t) numBands);
+        std::memcpy(getQuietSamples(channel), other.getQuietSamples(channel), sizeof(int) * (size_t) numBands);
+        std::memcpy(getSuspended(channel), other.getSuspended(channel), sizeof(bool) * (size_t) numBands);
+
+        if (layout.correlationSize == other.layout.correlationSize)
+            std::memcpy(getCorrelationStorage(channel), other.getCorrelationStorage(channel), sizeof(float) * (size_t) layout.correlationSize);
+    }
+}
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    DspStateArena.h
+    All per-instance DSP state in one zeroed, cache-line-aligned allocation,
+    laid out for one configuration: filter stages per channel, bank and
+    band, the three envelope followers, band activity, the correlation
+    trackers' windows and, for the state variable engine, the per-segment
+    band coefficients. Each section starts on its own cache line.
+
+    Arenas are built off the audio thread; the processor swaps a new one in
+    between blocks and carries the overlapping state across.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VocoderDsp.h"
+
+class DspStateArena
+{
+public:
+    struct Layout
+    {
+        double sampleRate = 0.0;
+        int numChannels = 0;
+        int numBands = 0;
+        int order = 0;
+        // Update segments per sub-block for the state variable engine, 0
+        // for the biquads.
+        int numSvfSegments = 0;
+        // Floats of correlation window per channel.
+        int correlationSize = 0;
+
+        bool operator== (const Layout& other) const {
+            return sampleRate == other.sampleRate && numChannels == other.numChannels && numBands == other.numBands
+                && order == other.order && numSvfSegments == other.numSvfSegments && correlationSize == other.correlationSize;
+        }
+        bool operator!= (const Layout& other) const { return ! operator== (other); }
+    };
+
+    enum Bank { sidechainBank, mainBank, numBanks };
+    enum Follower { sidechainFollower, mainInputFollower, outputFollower, numFollowers };
+
+    // Allocates; message or background thread only.
+    explicit DspStateArena(const Layout& layout);
+
+    const Layout& getLayout() const noexcept { return layout; }
+    size_t getSizeInBytes() const noexcept { return totalSize; }
+
+    // The `order` stages of one band.
+    VocoderDsp::StageState* getStages(int channel, Bank bank, int band) noexcept {
+        return at<VocoderDsp::StageState>(stagesOffset) + ((channel * numBanks + bank) * layout.numBands + band) * layout.order;
+    }
+    // numBands follower states.
+    float* getEnvelopes(Follower follower, int channel) noexcept {
+        return at<float>(envelopesOffset) + (follower * layout.numChannels + channel) * layout.numBands;
+    }
+    int* getQuietSamples(int channel) noexcept { return at<int>(quietOffset) + channel * layout.numBands; }
+    bool* getSuspended(int channel) noexcept { return at<bool>(suspendedOffset) + channel * layout.numBands; }
+    float* getCorrelationStorage(int channel) noexcept { return at<float>(correlationOffset) + channel * layout.correlationSize; }
+    // numBands coefficients of one bank's update segment; a bank's segments
+    // follow each other.
+    VocoderDsp::SvfCoefficients* getSvfCoefficients(Bank bank, int segment) noexcept {
+        return at<VocoderDsp::SvfCoefficients>(svfOffset) + (bank * layout.numSvfSegments + segment) * layout.numBands;
+    }
+
+    void clearFilterStates() noexcept;
+    void clearFollowers() noexcept;
+
+    // Copies the state of the channels, bands and stages both arenas have
+    // (the correlation windows only if they are the same size). Real-time
+    // safe.
+    void copyStateFrom(DspStateArena& other) noexcept;
+
+private:
+    template <typename T> T* at(size_t offset) noexcept { return reinterpret_cast<T*>(base + offset); }
+
+    Layout layout;
+    juce::HeapBlock<char> memory;
+    char* base = nullptr;
+    size_t stagesOffset = 0, envelopesOffset = 0, quietOffset = 0, suspendedOffset = 0;
+    size_t correlationOffset = 0, svfOffset = 0, endOfFollowers = 0, totalSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(DspStateArena)
+};
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    EnvelopeCapture.cpp
+
+  ==============================================================================
+*/
+
+#include "EnvelopeCapture.h"
+
+EnvelopeCapture::EnvelopeCapture(int _maxChannels, int _maxBands)
+    : juce::Thread("Envelope capture writer"),
+      maxChannels(_maxChannels), maxBands(_maxBands), frameStride(_maxChannels + _maxChannels * _maxBands) {
+}
+
+EnvelopeCapture::~EnvelopeCapture() {
+    stop();
+}
+
+bool EnvelopeCapture::start(const juce::File& file) {
+    stop();
+
+    file.deleteFile();
+    stream = std::make_unique<juce::FileOutputStream>(file);
+    if (stream->failedToOpen()) {
+        stream.reset();
+        return false;
+    }
+
+    if (headers.empty()) {
+        headers.resize((size_t) ringSize);
+        frameData.resize((size_t) ringSize * (size_t) frameStride);
+    }
+
+    fifo.reset();
+    droppedFrames.store(0);
+    nextSample = 0;
+
+    stream->write("OVEC", 4);
+    stream->writeInt(fileVersion);
+
+    capturing.store(true, std::memory_order_release);
+    startThread();
+    return true;
+}
+
+void EnvelopeCapture::stop() {
+    if (stream == nullptr)
+        return;
+
+    capturing.store(false);
+    stopThread(2000);
+
+    flush();
+    stream.reset();
+}
+
+void EnvelopeCapture::run() {
+    while (! threadShouldExit()) {
+        flush();
+        wait(50);
+    }
+}
+
+void EnvelopeCapture::flush() {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1; i++)
+        writeFrame(start1 + i);
+    for (int i = 0; i < size2; i++)
+        writeFrame(start2 + i);
+    fifo.finishedRead(size1 + size2);
+    stream->flush();
+}
+
+void EnvelopeCapture::writeFrame(int index) {
+    const auto& header = headers[(size_t) index];
+    const float* data = frameData.data() + (size_t) index * (size_t) frameStride;
+
+    stream->writeInt64(header.startSample);
+    stream->writeInt(header.numSamples);
+    stream->writeInt(header.sampleRate);
+    stream->writeInt(header.numChannels);
+    stream->writeInt(header.numBands);
+
+    for (int channel = 0; channel < header.numChannels; channel++)
+        stream->writeFloat(data[channel]);
+    for (int channel = 0; channel < header.numChannels; channel++)
+        for (int band = 0; band < header.numBands; band++)
+            stream->writeFloat(data[maxChannels + channel * maxBands + band]);
+}
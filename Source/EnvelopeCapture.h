@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    EnvelopeCapture.h
+    Opt-in recording of the sidechain band envelopes and correlation, one
+    frame per block, for offline analysis. The audio thread copies frames
+    into a preallocated lock-free ring; a background thread appends them to
+    a compact binary file. OvocoderEnvelopeExport converts it to CSV.
+
+    File layout, little-endian:
+        "OVEC", int32 version
+        per frame: int64 startSample, int32 numSamples, int32 sampleRate,
+                   int32 numChannels, int32 numBands,
+                   float correlation[numChannels],
+                   float envelopes[numChannels][numBands]
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class EnvelopeCapture : private juce::Thread
+{
+public:
+    static constexpr int fileVersion = 1;
+
+    EnvelopeCapture(int maxChannels, int maxBands);
+    ~EnvelopeCapture() override;
+
+    // Message thread. Starting truncates the file; stopping writes whatever
+    // is still queued.
+    bool start(const juce::File& file);
+    void stop();
+    bool isCapturing() const noexcept { return capturing.load(); }
+
+    // Number of frames lost because the writer fell behind.
+    int getNumDroppedFrames() const noexcept { return droppedFrames.load(); }
+
+    //==============================================================================
+    // Audio thread. envelopes[channel] points at numBands values. Copies
+    // into the ring only; never blocks, allocates or touches the file.
+    void push(int numSamples, double sampleRate, int numChannels, int numBands,
+              const float* correlation, const float* const* envelopes) noexcept {
+        if (! capturing.load(std::memory_order_acquire))
+            return;
+
+        numChannels = juce::jmin(numChannels, maxChannels);
+        numBands = juce::jmin(numBands, maxBands);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            droppedFrames.fetch_add(1);
+            nextSample += numSamples;
+            return;
+        }
+
+        auto& header = headers[(size_t) start1];
+        header = { nextSample, numSamples, (int) sampleRate, numChannels, numBands };
+
+        float* data = frameData.data() + (size_t) start1 * (size_t) frameStride;
+        std::memcpy(data, correlation, sizeof(float) * (size_t) numChannels);
+        for (int channel = 0; channel < numChannels; channel++)
+            std::memcpy(data + maxChannels + channel * maxBands, envelopes[channel], sizeof(float) * (size_t) numBands);
+
+        fifo.finishedWrite(1);
+        nextSample += numSamples;
+    }
+
+private:
+    struct FrameHeader
+    {
+        juce::int64 startSample;
+        int numSamples, sampleRate, numChannels, numBands;
+    };
+
+    static constexpr int ringSize = 4096;
+
+    const int maxChannels, maxBands, frameStride;
+
+    std::atomic<bool> capturing { false };
+    std::atomic<int> droppedFrames { 0 };
+    juce::int64 nextSample = 0;
+
+    // Allocated on the first start() and kept, so a block that raced with
+    // stop() never writes into freed memory.
+    juce::AbstractFifo fifo { ringSize };
+    std::vector<FrameHeader> headers;
+    std::vector<float> frameData;
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+
+    void run() override;
+    void flush();
+    void writeFrame(int index);
+
+    JUCE_DECLARE_NON_COPYABLE (EnvelopeCapture)
+};
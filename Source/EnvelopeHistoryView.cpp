@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    EnvelopeHistoryView.cpp
+
+  ==============================================================================
+*/
+
+#include "EnvelopeHistoryView.h"
+
+EnvelopeHistoryView::EnvelopeHistoryView() {
+    setOpaque(true);
+}
+
+bool EnvelopeHistoryView::addColumn(const OvocoderAudioProcessor::EnvelopeHistoryFrame& frame, int channel) {
+    // A level that rounds to the background colour draws nothing visible.
+    const float* levels = frame.getEnvelopes(channel);
+    bool blank = true;
+    for (int band = 0; band < frame.numBands && blank; band++)
+        blank = levels[band] < 0.5f / 255.0f;
+
+    const int width = history.getWidth();
+    if (blank && trailingBlankColumns >= width)
+        return false;
+    trailingBlankColumns = blank ? trailingBlankColumns + 1 : 0;
+
+    const int x = nextColumn;
+    nextColumn = (nextColumn + 1) % width;
+
+    const int height = history.getHeight();
+    juce::Graphics g(history);
+    g.setColour(juce::Colours::black);
+    g.fillRect(x, 0, 1, height);
+    if (blank)
+        return true;
+
+    // With more bands than pixel rows, each row shows the loudest of the
+    // bands that fall into it.
+    for (int band = 0; band < frame.numBands;) {
+        const int bottom = height - band * height / frame.numBands;
+        float level = 0.0f;
+        int top = bottom;
+        while (band < frame.numBands && top == bottom) {
+            level = juce::jmax(level, frame.getEnvelopes(channel)[band]);
+            band++;
+            top = height - band * height / frame.numBands;
+        }
+        g.setColour(juce::Colours::black.interpolatedWith(colour, juce::jlimit(0.0f, 1.0f, level)));
+        g.fillRect(x, top, 1, bottom - top);
+    }
+    return true;
+}
+
+void EnvelopeHistoryView::paint(juce::Graphics& g) {
+    // Columns from nextColumn on are the oldest.
+    const int width = history.getWidth();
+    const int height = history.getHeight();
+    g.drawImage(history, 0, 0, width - nextColumn, height, nextColumn, 0, width - nextColumn, height);
+    if (nextColumn > 0)
+        g.drawImage(history, width - nextColumn, 0, nextColumn, height, 0, 0, nextColumn, height);
+}
+
+void EnvelopeHistoryView::resized() {
+    // Resizing starts a fresh history rather than rescaling the old columns.
+    history = juce::Image(juce::Image::RGB, juce::jmax(1, getWidth()), juce::jmax(1, getHeight()), true);
+    nextColumn = 0;
+    trailingBlankColumns = history.getWidth();
+}
@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    EnvelopeHistoryView.h
+    Scrolling band-envelope history, one column per fixed slice of time with
+    the lowest band at the bottom. Columns are written into a persistent
+    image used as a ring, so adding one never moves the rest; paint draws
+    the ring in two pieces, oldest column at the left.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class EnvelopeHistoryView  : public juce::Component
+{
+public:
+    EnvelopeHistoryView();
+
+    // Appends a column at the right edge. Returns false, and draws nothing,
+    // when a blank column would scroll into an all blank view, so callers
+    // only repaint when pixels change. Repaint after a batch.
+    bool addColumn(const OvocoderAudioProcessor::EnvelopeHistoryFrame& frame, int channel);
+
+    void setColour(juce::Colour newColour) { colour = newColour; }
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    juce::Image history;
+    juce::Colour colour = juce::Colours::white;
+    int nextColumn = 0;
+    // Blank columns at the right edge; the view is all blank at its width.
+    int trailingBlankColumns = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EnvelopeHistoryView)
+};
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    FormantRemap.h
+    Sparse matrix that resamples the analysis band envelopes onto the carrier
+    bands, for formant shift and warp. The bands are log spaced, so a shift
+    by a musical interval is a constant offset in band index and a warp is a
+    scaling of the band index around the centre band. Every carrier band
+    reads at most two neighbouring analysis bands, linearly interpolated.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template <int MaxBands>
+class FormantRemap
+{
+public:
+    // shiftBands > 0 moves the formants up, stretch > 1 spreads them away
+    // from the centre band. Carrier bands that map outside the analysis
+    // bands get a zero envelope.
+    void update(int newNumBands, float shiftBands, float stretch) noexcept {
+        numBands = juce::jlimit(0, MaxBands, newNumBands);
+        const float centre = 0.5f * (float) (numBands - 1);
+        for (int band = 0; band < numBands; band++) {
+            auto& row = rows[band];
+            const float position = centre + ((float) band - centre) / stretch - shiftBands;
+            row = {};
+            if (position <= -1.0f || position >= (float) numBands)
+                continue;
+
+            const int lower = (int) std::floor(position);
+            const float fraction = position - (float) lower;
+            if (lower < 0) {
+                row.weights[0] = fraction;
+            } else {
+                row.source = lower;
+                row.weights[0] = 1.0f - fraction;
+                row.weights[1] = lower + 1 < numBands ? fraction : 0.0f;
+            }
+        }
+    }
+
+    int getNumBands() const noexcept { return numBands; }
+
+    // Carrier band `band` of one chunk, from the analysis envelopes (one
+    // channel per band).
+    void applyRow(int band, const juce::AudioBuffer<float>& analysis, float* envelope, int numSamples) const noexcept {
+        const auto& row = rows[band];
+        if (row.weights[0] == 0.0f && row.weights[1] == 0.0f) {
+            juce::FloatVectorOperations::clear(envelope, numSamples);
+            return;
+        }
+        juce::FloatVectorOperations::copyWithMultiply(envelope, analysis.getReadPointer(row.source), row.weights[0], numSamples);
+        if (row.weights[1] != 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(envelope, analysis.getReadPointer(row.source + 1), row.weights[1], numSamples);
+    }
+
+private:
+    struct Row
+    {
+        int source = 0;
+        float weights[2] = { 0.0f, 0.0f };
+    };
+
+    int numBands = 0;
+    Row rows[MaxBands];
+};
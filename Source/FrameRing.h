@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    FrameRing.h
+    Single-producer, single-consumer ring of fixed-size frames. push() never
+    blocks or allocates; when the reader falls behind, new frames are dropped
+    and counted rather than overwriting ones the reader may be copying.
+    Storage only exists between allocate() and release(), which is how a
+    frame type sized at run time is preallocated.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template <typename FrameType>
+class FrameRing
+{
+public:
+    // Neither side may use the ring during these. Every slot is a copy of
+    // prototype, so copying a frame of the same size into it never allocates.
+    void allocate(int numFrames, const FrameType& prototype) {
+        frames.assign((size_t) numFrames, prototype);
+        fifo.setTotalSize(numFrames);
+        fifo.reset();
+        droppedFrames.store(0);
+    }
+
+    void release() {
+        std::vector<FrameType>().swap(frames);
+        fifo.setTotalSize(1);
+        fifo.reset();
+    }
+
+    // Writer side. Returns false if the ring was full.
+    bool push(const FrameType& frame) noexcept {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        frames[(size_t) start1] = frame;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    // Reader side. Returns false when no frame is waiting.
+    bool pop(FrameType& frame) noexcept {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 == 0)
+            return false;
+        frame = frames[(size_t) start1];
+        fifo.finishedRead(1);
+        return true;
+    }
+
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+    juce::uint32 getNumDroppedFrames() const noexcept { return droppedFrames.load(std::memory_order_relaxed); }
+
+private:
+    // Capacity one holds no frames, so an unallocated ring drops every push.
+    juce::AbstractFifo fifo { 1 };
+    std::vector<FrameType> frames;
+    std::atomic<juce::uint32> droppedFrames { 0 };
+};
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    MetricsPublisher.cpp
+
+  ==============================================================================
+*/
+
+#include "MetricsPublisher.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <signal.h>
+ #include <cerrno>
+#endif
+
+namespace OvocoderMetrics
+{
+    Segment* mapSegment(const juce::String& name, bool create) {
+       #if JUCE_LINUX || JUCE_MAC
+        const int fd = shm_open(name.toRawUTF8(), create ? (O_CREAT | O_RDWR) : O_RDONLY, 0666);
+        if (fd < 0)
+            return nullptr;
+
+        if (create) {
+            // Several processes may race here; they all truncate to the same size.
+            struct stat info;
+            if (fstat(fd, &info) != 0 || (info.st_size < (off_t) sizeof(Segment) && ftruncate(fd, sizeof(Segment)) != 0)) {
+                close(fd);
+                return nullptr;
+            }
+        }
+
+        void* address = mmap(nullptr, sizeof(Segment), create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+            return nullptr;
+
+        auto* segment = static_cast<Segment*>(address);
+        if (create) {
+            juce::uint32 expected = 0;
+            if (segment->magic.compare_exchange_strong(expected, magic))
+                segment->numSlots = maxInstances;
+        }
+
+        if (segment->magic.load() != magic) {
+            munmap(address, sizeof(Segment));
+            return nullptr;
+        }
+        return segment;
+       #else
+        juce::ignoreUnused(name, create);
+        return nullptr;
+       #endif
+    }
+
+    void unmapSegment(Segment* segment) {
+       #if JUCE_LINUX || JUCE_MAC
+        if (segment != nullptr)
+            munmap(segment, sizeof(Segment));
+       #else
+        juce::ignoreUnused(segment);
+       #endif
+    }
+
+    bool isProcessAlive(juce::int32 pid) {
+       #if JUCE_LINUX || JUCE_MAC
+        return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+       #else
+        juce::ignoreUnused(pid);
+        return false;
+       #endif
+    }
+}
+
+static std::atomic<int> nextInstanceId { 0 };
+
+MetricsPublisher::MetricsPublisher() {
+   #if JUCE_LINUX || JUCE_MAC
+    auto setting = juce::SystemStats::getEnvironmentVariable("OVOCODER_METRICS", {});
+    if (setting.isEmpty() || setting == "0")
+        return;
+
+    segment = OvocoderMetrics::mapSegment(setting == "1" ? juce::String(OvocoderMetrics::defaultSegmentName) : setting, true);
+    if (segment == nullptr)
+        return;
+
+    // Take a free slot, or one left behind by a process that has died.
+    const auto pid = (juce::int32) getpid();
+    for (auto& candidate : segment->slots) {
+        auto owner = candidate.ownerPid.load();
+        if ((owner == 0 || ! OvocoderMetrics::isProcessAlive(owner)) && candidate.ownerPid.compare_exchange_strong(owner, pid)) {
+            candidate.instanceId = nextInstanceId++;
+            slot = &candidate;
+            slot->metrics.write(current);
+            break;
+        }
+    }
+   #endif
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    if (slot != nullptr)
+        slot->ownerPid.store(0);
+    OvocoderMetrics::unmapSegment(segment);
+}
+
+void MetricsPublisher::prepare(double sampleRate, int blockSize) {
+    if (slot == nullptr)
+        return;
+
+    current = {};
+    current.sampleRate = sampleRate;
+    current.blockSize = blockSize;
+    slot->metrics.write(current);
+}
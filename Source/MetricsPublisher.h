@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    MetricsPublisher.h
+    Per-instance processing statistics published into a POSIX shared-memory
+    segment, so that render hosts can monitor every running instance
+    without opening editors. Each instance claims a slot; the audio thread
+    updates the slot through a SeqLock once per block.
+
+    Off unless the OVOCODER_METRICS environment variable is set, either to
+    "1" for the default segment name or to a segment name of its own.
+    POSIX only; elsewhere the publisher does nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SeqLock.h"
+
+namespace OvocoderMetrics
+{
+    static constexpr const char* defaultSegmentName = "/ovocoder-metrics";
+    static constexpr juce::uint32 magic = 0x4f564d31; // "OVM1"
+    static constexpr int maxInstances = 256;
+
+    struct InstanceMetrics
+    {
+        juce::uint64 blocksProcessed;
+        juce::uint64 deadlineOverruns;
+        double totalProcessSeconds;
+        double maxProcessSeconds;
+        double lastProcessSeconds;
+        double sampleRate;
+        juce::int32 blockSize;
+        juce::int32 numBands;
+        juce::int32 order;
+        juce::int32 correlationEnabled;
+    };
+
+    struct Slot
+    {
+        // Owning process id, 0 when free. Claimed with a compare-exchange.
+        std::atomic<juce::int32> ownerPid;
+        juce::int32 instanceId;
+        SeqLock<InstanceMetrics> metrics;
+    };
+
+    // The segment is created zero-filled, which is a valid empty state for
+    // every field, so it needs no initialisation beyond the header.
+    struct Segment
+    {
+        std::atomic<juce::uint32> magic;
+        juce::uint32 numSlots;
+        Slot slots[maxInstances];
+    };
+
+    // Maps the segment, creating it when `create` is set. Returns nullptr on
+    // failure or on platforms without POSIX shared memory.
+    Segment* mapSegment(const juce::String& name, bool create);
+    void unmapSegment(Segment* segment);
+
+    bool isProcessAlive(juce::int32 pid);
+}
+
+class MetricsPublisher
+{
+public:
+    MetricsPublisher();
+    ~MetricsPublisher();
+
+    bool isPublishing() const noexcept { return slot != nullptr; }
+
+    // Message thread, before processing starts.
+    void prepare(double sampleRate, int blockSize);
+
+    // Audio thread, once per block.
+    void publish(int numSamples, double processSeconds, int numBands, int order, bool correlationEnabled) noexcept {
+        if (slot == nullptr)
+            return;
+
+        current.blocksProcessed++;
+        current.totalProcessSeconds += processSeconds;
+        current.lastProcessSeconds = processSeconds;
+        current.maxProcessSeconds = juce::jmax(current.maxProcessSeconds, processSeconds);
+        if (processSeconds * current.sampleRate > numSamples)
+            current.deadlineOverruns++;
+        current.numBands = numBands;
+        current.order = order;
+        current.correlationEnabled = correlationEnabled ? 1 : 0;
+        slot->metrics.write(current);
+    }
+
+private:
+    OvocoderMetrics::Segment* segment = nullptr;
+    OvocoderMetrics::Slot* slot = nullptr;
+    OvocoderMetrics::InstanceMetrics current {};
+
+    JUCE_DECLARE_NON_COPYABLE (MetricsPublisher)
+};
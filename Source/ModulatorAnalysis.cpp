@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    ModulatorAnalysis.cpp
+
+  ==============================================================================
+*/
+
+#include "ModulatorAnalysis.h"
+
+bool ModulatorAnalysis::Key::operator==(const Key& other) const noexcept {
+    return sampleRate == other.sampleRate
+        && blockSize == other.blockSize
+        && numBands == other.numBands
+        && order == other.order
+        && correlationEnabled == other.correlationEnabled
+        && minFreq == other.minFreq
+        && maxFreq == other.maxFreq
+        && q == other.q
+        && attackMs == other.attackMs
+        && releaseMs == other.releaseMs
+        && filterEngine == other.filterEngine;
+}
+
+juce::String ModulatorAnalysis::Key::toString() const {
+    juce::String text;
+    text << "sr" << juce::String(sampleRate, 0) << "_bs" << blockSize << "_b" << numBands << "_o" << order
+         << "_c" << correlationEnabled << "_f" << juce::String(minFreq, 3) << "-" << juce::String(maxFreq, 3)
+         << "_q" << juce::String(q, 4) << "_a" << juce::String(attackMs, 4) << "_r" << juce::String(releaseMs, 4)
+         << "_e" << filterEngine;
+    return text;
+}
+
+ModulatorAnalysis::ModulatorAnalysis(std::unique_ptr<juce::MemoryMappedFile> mappedFile)
+    : file(std::move(mappedFile)) {
+    setData(static_cast<char*>(file->getData()));
+}
+
+ModulatorAnalysis::ModulatorAnalysis(juce::HeapBlock<char> data)
+    : memory(std::move(data)) {
+    setData(memory.get());
+}
+
+void ModulatorAnalysis::setData(char* data) {
+    header = reinterpret_cast<Header*>(data);
+    streams = reinterpret_cast<float*>(data + headerSize);
+}
+
+ModulatorAnalysis::Header ModulatorAnalysis::makeHeader(const Key& key, int numChannels, juce::int64 numSamples, int samplesPerFrame) {
+    Header header {};
+    std::memcpy(header.magic, "OVMA", 4);
+    header.version = fileVersion;
+    header.complete = 0;
+    header.numChannels = numChannels;
+    header.samplesPerFrame = samplesPerFrame;
+    header.numSamples = numSamples;
+    header.key = key;
+    return header;
+}
+
+juce::int64 ModulatorAnalysis::getFileSize(const Key& key, int numChannels, juce::int64 numSamples, int samplesPerFrame) {
+    return headerSize + (juce::int64) sizeof(float) * numChannels * (key.numBands + 1) * getNumFrames(numSamples, samplesPerFrame);
+}
+
+std::unique_ptr<ModulatorAnalysis> ModulatorAnalysis::create(const juce::File& path, const Key& key, int numChannels, juce::int64 numSamples, juce::String& error) {
+    const auto fileSize = getFileSize(key, numChannels, numSamples, fileSamplesPerFrame);
+
+    path.deleteFile();
+    {
+        juce::FileOutputStream stream (path);
+        if (stream.failedToOpen()) {
+            error = "Could not create " + path.getFullPathName();
+            return nullptr;
+        }
+
+        const auto header = makeHeader(key, numChannels, numSamples, fileSamplesPerFrame);
+        char headerBytes[headerSize] = {};
+        std::memcpy(headerBytes, &header, sizeof(Header));
+        stream.write(headerBytes, headerSize);
+
+        // Extends the file to its full size without writing the streams.
+        stream.setPosition(fileSize);
+        if (stream.truncate().failed()) {
+            error = "Could not size " + path.getFullPathName();
+            return nullptr;
+        }
+    }
+
+    auto mappedFile = std::make_unique<juce::MemoryMappedFile>(path, juce::MemoryMappedFile::readWrite);
+    if (mappedFile->getData() == nullptr || (juce::int64) mappedFile->getSize() < fileSize) {
+        error = "Could not map " + path.getFullPathName();
+        return nullptr;
+    }
+
+    return std::unique_ptr<ModulatorAnalysis>(new ModulatorAnalysis(std::move(mappedFile)));
+}
+
+std::unique_ptr<ModulatorAnalysis> ModulatorAnalysis::createInMemory(const Key& key, int numChannels, juce::int64 numSamples) {
+    juce::HeapBlock<char> data ((size_t) getFileSize(key, numChannels, numSamples, 1), true);
+    const auto header = makeHeader(key, numChannels, numSamples, 1);
+    std::memcpy(data.get(), &header, sizeof(Header));
+    return std::unique_ptr<ModulatorAnalysis>(new ModulatorAnalysis(std::move(data)));
+}
+
+std::unique_ptr<ModulatorAnalysis> ModulatorAnalysis::open(const juce::File& path, juce::String& error) {
+    auto mappedFile = std::make_unique<juce::MemoryMappedFile>(path, juce::MemoryMappedFile::readOnly);
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < (size_t) headerSize) {
+        error = "Could not map " + path.getFullPathName();
+        return nullptr;
+    }
+
+    Header header;
+    std::memcpy(&header, mappedFile->getData(), sizeof(Header));
+    if (std::memcmp(header.magic, "OVMA", 4) != 0 || header.version != fileVersion) {
+        error = path.getFullPathName() + " is not a modulator analysis of this version";
+        return nullptr;
+    }
+    if (header.complete == 0) {
+        error = path.getFullPathName() + " was not completely recorded";
+        return nullptr;
+    }
+    if (header.numChannels <= 0 || header.key.numBands <= 0 || header.numSamples < 0 || header.samplesPerFrame <= 0
+        || (juce::int64) mappedFile->getSize() < getFileSize(header.key, header.numChannels, header.numSamples, header.samplesPerFrame)) {
+        error = path.getFullPathName() + " is truncated";
+        return nullptr;
+    }
+
+    return std::unique_ptr<ModulatorAnalysis>(new ModulatorAnalysis(std::move(mappedFile)));
+}
+
+void ModulatorAnalysis::markComplete() noexcept {
+    header->complete = 1;
+}
+
+// Runs of samples that share a frame are filled at once. Past the last
+// frame an envelope holds its value until the end of the analysis.
+void ModulatorAnalysis::readFrames(const float* frames, juce::int64 position, float* dest, int numSamples, bool interpolate) const noexcept {
+    const int samplesPerFrame = header->samplesPerFrame;
+    const juce::int64 length = header->numSamples;
+    int done = 0;
+
+    if (samplesPerFrame == 1) {
+        done = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, length - position);
+        if (done > 0)
+            std::memcpy(dest, frames + position, sizeof(float) * (size_t) done);
+    } else {
+        const juce::int64 numFrames = getNumFrames(length, samplesPerFrame);
+        while (done < numSamples && position + done < length) {
+            const juce::int64 sample = position + done;
+            const juce::int64 frame = sample / samplesPerFrame;
+            const int phase = (int) (sample - frame * samplesPerFrame);
+            const int run = (int) juce::jmin((juce::int64) (samplesPerFrame - phase), (juce::int64) (numSamples - done), length - sample);
+
+            const float value = frames[frame];
+            if (interpolate && frame + 1 < numFrames) {
+                const float step = (frames[frame + 1] - value) / (float) samplesPerFrame;
+                for (int i = 0; i < run; i++)
+                    dest[done + i] = value + step * (float) (phase + i);
+            } else {
+                juce::FloatVectorOperations::fill(dest + done, value, run);
+            }
+            done += run;
+        }
+    }
+
+    if (done < numSamples)
+        juce::FloatVectorOperations::clear(dest + juce::jmax(0, done), numSamples - juce::jmax(0, done));
+}
+
+void ModulatorAnalysis::writeFrames(float* frames, juce::int64 position, const float* source, int numSamples) noexcept {
+    const int samplesPerFrame = header->samplesPerFrame;
+    const juce::int64 end = juce::jmin(position + numSamples, header->numSamples);
+    for (juce::int64 sample = getNumFrames(position, samplesPerFrame) * samplesPerFrame; sample < end; sample += samplesPerFrame)
+        frames[sample / samplesPerFrame] = source[sample - position];
+}
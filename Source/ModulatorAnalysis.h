@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    ModulatorAnalysis.h
+    Cached sidechain analysis for offline rendering: the band envelopes and
+    correlation track of one modulator, stored as contiguous per-band float
+    streams in a memory-mapped file. An engine in record mode fills it while
+    rendering normally; in replay mode it reads the envelopes from it and
+    skips the sidechain filterbank and envelope followers.
+
+    The streams hold one frame, the value at its first sample, per
+    samplesPerFrame samples. Files use one frame per correlation update, so
+    the correlation track (a step per update) is held exactly and the
+    envelopes are interpolated linearly between frames on replay.
+
+    The file is a local cache, written in native byte order:
+        Header (headerSize bytes)
+        for each channel: numBands envelope streams, then the correlation
+        stream, each getNumFrames() floats.
+
+    An analysis is only valid for the parameters in its Key.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CorrelationTracker.h"
+
+class ModulatorAnalysis
+{
+public:
+    // Everything the sidechain analysis depends on. The block size is part
+    // of it because blocks that are not a multiple of the correlation
+    // decimation shift the detector's sampling phase.
+    struct Key
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        int numBands = 0;
+        int order = 0;
+        int correlationEnabled = 0;
+        float minFreq = 0.0f, maxFreq = 0.0f, q = 0.0f;
+        float attackMs = 0.0f, releaseMs = 0.0f;
+        // 0 for the biquads, 1 for the state variable filters.
+        int filterEngine = 0;
+
+        bool operator==(const Key& other) const noexcept;
+        bool operator!=(const Key& other) const noexcept { return ! operator==(other); }
+
+        // Stable text form for cache file names.
+        juce::String toString() const;
+    };
+
+    static constexpr int fileVersion = 3;
+    static constexpr int fileSamplesPerFrame = AUTOCORRELATION_DOWNSAMPLE;
+
+    // Creates (replacing any existing file) an analysis ready to be recorded.
+    static std::unique_ptr<ModulatorAnalysis> create(const juce::File& file, const Key& key, int numChannels, juce::int64 numSamples, juce::String& error);
+
+    // Heap-backed analysis, e.g. one block long and shared by several
+    // engines rendering different carriers against the same modulator. It
+    // keeps every sample, so replaying it matches the live analysis.
+    static std::unique_ptr<ModulatorAnalysis> createInMemory(const Key& key, int numChannels, juce::int64 numSamples);
+
+    // Opens a completely recorded analysis for replay.
+    static std::unique_ptr<ModulatorAnalysis> open(const juce::File& file, juce::String& error);
+
+    // Marks a recording as complete; open() refuses analyses without it.
+    void markComplete() noexcept;
+
+    const Key& getKey() const noexcept { return header->key; }
+    int getNumChannels() const noexcept { return header->numChannels; }
+    juce::int64 getNumSamples() const noexcept { return header->numSamples; }
+    int getSamplesPerFrame() const noexcept { return header->samplesPerFrame; }
+
+    //==============================================================================
+    // Reconstruct numSamples values starting at sample position into dest,
+    // zero-filling whatever lies past the end of the analysis.
+    void readEnvelopes(int channel, int band, juce::int64 position, float* dest, int numSamples) const noexcept {
+        readFrames(getStream(channel, band), position, dest, numSamples, true);
+    }
+    void readCorrelation(int channel, juce::int64 position, float* dest, int numSamples) const noexcept {
+        readFrames(getStream(channel, header->key.numBands), position, dest, numSamples, false);
+    }
+
+    // Store the frames that start within numSamples values from position,
+    // dropping whatever lies past the end. Only valid on an analysis from
+    // create() or createInMemory().
+    void writeEnvelopes(int channel, int band, juce::int64 position, const float* source, int numSamples) noexcept {
+        writeFrames(getStream(channel, band), position, source, numSamples);
+    }
+    void writeCorrelation(int channel, juce::int64 position, const float* source, int numSamples) noexcept {
+        writeFrames(getStream(channel, header->key.numBands), position, source, numSamples);
+    }
+
+private:
+    static constexpr int headerSize = 256;
+
+    struct Header
+    {
+        char magic[4];
+        int version;
+        int complete;
+        int numChannels;
+        int samplesPerFrame;
+        juce::int64 numSamples;
+        Key key;
+    };
+
+    static_assert(sizeof(Header) <= headerSize, "Header does not fit");
+
+    explicit ModulatorAnalysis(std::unique_ptr<juce::MemoryMappedFile> mappedFile);
+    explicit ModulatorAnalysis(juce::HeapBlock<char> data);
+    void setData(char* data);
+
+    static juce::int64 getNumFrames(juce::int64 numSamples, int samplesPerFrame) noexcept {
+        return (numSamples + samplesPerFrame - 1) / samplesPerFrame;
+    }
+    static juce::int64 getFileSize(const Key& key, int numChannels, juce::int64 numSamples, int samplesPerFrame);
+    static Header makeHeader(const Key& key, int numChannels, juce::int64 numSamples, int samplesPerFrame);
+
+    float* getStream(int channel, int stream) const noexcept {
+        return streams + ((juce::int64) channel * (header->key.numBands + 1) + stream) * getNumFrames(header->numSamples, header->samplesPerFrame);
+    }
+
+    void readFrames(const float* frames, juce::int64 position, float* dest, int numSamples, bool interpolate) const noexcept;
+    void writeFrames(float* frames, juce::int64 position, const float* source, int numSamples) noexcept;
+
+    std::unique_ptr<juce::MemoryMappedFile> file;
+    juce::HeapBlock<char> memory;
+    Header* header = nullptr;
+    float* streams = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (ModulatorAnalysis)
+};
@@ -12,28 +12,37 @@
 //==============================================================================
 OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
+    meteringFrame(p.getLimits().maxBands),
+    incomingMeteringFrame(p.getLimits().maxBands),
+    historyFrame(p.getLimits().maxBands),
+    historyPeak(p.getLimits().maxBands),
     attackSliderAttachment(audioProcessor.apvts, "attack", attackSlider),
     releaseSliderAttachment(audioProcessor.apvts, "release", releaseSlider),
     filterQualitySliderAttachment(audioProcessor.apvts, "q", filterQualitySlider),
     filterOrderSliderAttachment(audioProcessor.apvts, "order", filterOrderSlider),
     outputGainSliderAttachment(audioProcessor.apvts, "gain", outputGainSlider),
     correlationEnabledButtonAttachment(audioProcessor.apvts, "correlation_enabled", correlationEnabledButton),
+    bypassButtonAttachment(audioProcessor.apvts, "bypass", bypassButton),
     mixSliderAttachment(audioProcessor.apvts, "mix", mixSlider),
     numBandsSliderAttachment(audioProcessor.apvts, "num_bands", numBandsSlider),
     minFreqSliderAttachment(audioProcessor.apvts, "min_freq", minFreqSlider),
     maxFreqSliderAttachment(audioProcessor.apvts, "max_freq", maxFreqSlider),
-    processedGainSliderAttachment(audioProcessor.apvts, "proc_gain", processedGainSlider)
+    processedGainSliderAttachment(audioProcessor.apvts, "proc_gain", processedGainSlider),
+    formantShiftSliderAttachment(audioProcessor.apvts, "formant_shift", formantShiftSlider),
+    formantWarpSliderAttachment(audioProcessor.apvts, "formant_warp", formantWarpSlider),
+    morphSliderAttachment(audioProcessor.apvts, "morph", morphSlider),
+    sweepRateSliderAttachment(audioProcessor.apvts, "sweep_rate", sweepRateSlider),
+    sweepDepthSliderAttachment(audioProcessor.apvts, "sweep_depth", sweepDepthSlider),
+    sweepFollowSliderAttachment(audioProcessor.apvts, "sweep_follow", sweepFollowSlider)
 {
-
-    for (int channel = 0; channel < OvocoderAudioProcessor::numChannels; channel++) {
-      for (int band = 0; band < OvocoderAudioProcessor::maxBands; band++) {
-        bandEnvelopes[channel][band] = 0.0f;
-      }
-    }
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (1000, 600);
-    startTimer(32);
+    setSize (1000, 840);
+    startTimer(1000 / activeFrameRate);
+
+    CycleCounter::calibrateInBackground();
+    audioProcessor.getStageProfiler().setEnabled(true);
+    audioProcessor.setEnvelopeHistoryEnabled(true);
 
     displayedChannelButton.setButtonText("L");
     displayedChannelButton.onClick = [this] {
@@ -53,6 +62,16 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     addAndMakeVisible(minFreqSlider);
     addAndMakeVisible(maxFreqSlider);
     addAndMakeVisible(processedGainSlider);
+    addAndMakeVisible(formantShiftSlider);
+    addAndMakeVisible(formantWarpSlider);
+    addAndMakeVisible(morphSlider);
+    addAndMakeVisible(morphTargetBox);
+    addAndMakeVisible(bypassButton);
+    addAndMakeVisible(filterEngineBox);
+    addAndMakeVisible(sweepRateSlider);
+    addAndMakeVisible(sweepDepthSlider);
+    addAndMakeVisible(sweepFollowSlider);
+    addAndMakeVisible(historyView);
 
     attackSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
     releaseSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
@@ -64,6 +83,12 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
     maxFreqSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
     processedGainSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    formantShiftSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    formantWarpSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    morphSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    sweepRateSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    sweepDepthSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    sweepFollowSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
 
     attackSlider.setNumDecimalPlacesToDisplay(2);
     releaseSlider.setNumDecimalPlacesToDisplay(2);
@@ -73,6 +98,12 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqSlider.setNumDecimalPlacesToDisplay(1);
     maxFreqSlider.setNumDecimalPlacesToDisplay(1);
     processedGainSlider.setNumDecimalPlacesToDisplay(2);
+    formantShiftSlider.setNumDecimalPlacesToDisplay(2);
+    formantWarpSlider.setNumDecimalPlacesToDisplay(2);
+    morphSlider.setNumDecimalPlacesToDisplay(2);
+    sweepRateSlider.setNumDecimalPlacesToDisplay(2);
+    sweepDepthSlider.setNumDecimalPlacesToDisplay(2);
+    sweepFollowSlider.setNumDecimalPlacesToDisplay(2);
 
     attackSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
     releaseSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
@@ -84,6 +115,12 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
     maxFreqSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
     processedGainSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    formantShiftSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    formantWarpSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    morphSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    sweepRateSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    sweepDepthSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
+    sweepFollowSlider.setColour(juce::Slider::ColourIds::thumbColourId, mainColour);
 
     attackSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
     releaseSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
@@ -95,11 +132,21 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
     maxFreqSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
     processedGainSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    formantShiftSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    formantWarpSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    morphSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    sweepRateSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    sweepDepthSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
+    sweepFollowSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::TextBoxBelow, false, 60, 20);
 
     attackSlider.setTextValueSuffix("ms");
     releaseSlider.setTextValueSuffix("ms");
     outputGainSlider.setTextValueSuffix("db");
     processedGainSlider.setTextValueSuffix("db");
+    formantShiftSlider.setTextValueSuffix("st");
+    sweepRateSlider.setTextValueSuffix("Hz");
+    sweepDepthSlider.setTextValueSuffix("st");
+    sweepFollowSlider.setTextValueSuffix("st");
 
     minFreqSlider.setBounds(0, 40, 80, 80);
     maxFreqSlider.setBounds(100, 40, 80, 80);
@@ -111,9 +158,25 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     processedGainSlider.setBounds(690, 40, 100, 80);
     mixSlider.setBounds(800, 40, 80, 80);
     outputGainSlider.setBounds(900, 40, 80, 80);
+
+    formantShiftSlider.setBounds(0, 160, 80, 80);
+    formantWarpSlider.setBounds(100, 160, 80, 80);
+    morphSlider.setBounds(200, 160, 80, 80);
+    morphTargetBox.setBounds(300, 180, 160, 24);
+    bypassButton.setBounds(480, 177, 25, 30);
+    filterEngineBox.setBounds(580, 180, 120, 24);
+    sweepRateSlider.setBounds(720, 160, 80, 80);
+    sweepDepthSlider.setBounds(810, 160, 80, 80);
+    sweepFollowSlider.setBounds(900, 160, 80, 80);
+
+    morphTargetBox.addItemList(PresetBank::getFactoryPresetNames(), 1);
+    morphTargetBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, "morph_target", morphTargetBox);
+    filterEngineBox.addItemList(audioProcessor.apvts.getParameter("filter_engine")->getAllValueStrings(), 1);
+    filterEngineBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, "filter_engine", filterEngineBox);
   
-    correlationEnabledButton.setBounds(230, 135, 200, 30);
-    displayedChannelButton.setBounds(650, 138, 25, 25);
+    correlationEnabledButton.setBounds(230, 255, 200, 30);
+    displayedChannelButton.setBounds(650, 258, 25, 25);
+    historyView.setColour(sidechainColour);
 
     attackLabel.setText("Attack", juce::NotificationType::dontSendNotification);
     releaseLabel.setText("Release", juce::NotificationType::dontSendNotification);
@@ -126,6 +189,15 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqLabel.setText("Min freq", juce::NotificationType::dontSendNotification);
     maxFreqLabel.setText("Max freq", juce::NotificationType::dontSendNotification);
     processedGainLabel.setText("Processed gain", juce::NotificationType::dontSendNotification);
+    formantShiftLabel.setText("Formant shift", juce::NotificationType::dontSendNotification);
+    formantWarpLabel.setText("Formant warp", juce::NotificationType::dontSendNotification);
+    morphLabel.setText("Morph", juce::NotificationType::dontSendNotification);
+    morphTargetLabel.setText("Morph target", juce::NotificationType::dontSendNotification);
+    bypassButtonLabel.setText("Bypass", juce::NotificationType::dontSendNotification);
+    filterEngineLabel.setText("Filter engine", juce::NotificationType::dontSendNotification);
+    sweepRateLabel.setText("Sweep rate", juce::NotificationType::dontSendNotification);
+    sweepDepthLabel.setText("Sweep depth", juce::NotificationType::dontSendNotification);
+    sweepFollowLabel.setText("Sweep follow", juce::NotificationType::dontSendNotification);
 
     attackLabel.attachToComponent(&attackSlider, false);
     releaseLabel.attachToComponent(&releaseSlider, false);
@@ -137,7 +209,16 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     minFreqLabel.attachToComponent(&minFreqSlider, false);
     maxFreqLabel.attachToComponent(&maxFreqSlider, false);
     processedGainLabel.attachToComponent(&processedGainSlider, false);
-    correlationEnabledButtonLabel.setBounds(255, 134, 200, 30);
+    formantShiftLabel.attachToComponent(&formantShiftSlider, false);
+    formantWarpLabel.attachToComponent(&formantWarpSlider, false);
+    morphLabel.attachToComponent(&morphSlider, false);
+    morphTargetLabel.attachToComponent(&morphTargetBox, false);
+    filterEngineLabel.attachToComponent(&filterEngineBox, false);
+    sweepRateLabel.attachToComponent(&sweepRateSlider, false);
+    sweepDepthLabel.attachToComponent(&sweepDepthSlider, false);
+    sweepFollowLabel.attachToComponent(&sweepFollowSlider, false);
+    correlationEnabledButtonLabel.setBounds(255, 254, 200, 30);
+    bypassButtonLabel.setBounds(505, 176, 60, 30);
 
     addAndMakeVisible(attackLabel);
     addAndMakeVisible(releaseLabel);
@@ -150,85 +231,240 @@ OvocoderAudioProcessorEditor::OvocoderAudioProcessorEditor (OvocoderAudioProcess
     addAndMakeVisible(minFreqLabel);
     addAndMakeVisible(maxFreqLabel);
     addAndMakeVisible(processedGainLabel);
+    addAndMakeVisible(formantShiftLabel);
+    addAndMakeVisible(formantWarpLabel);
+    addAndMakeVisible(morphLabel);
+    addAndMakeVisible(morphTargetLabel);
+    addAndMakeVisible(bypassButtonLabel);
+    addAndMakeVisible(filterEngineLabel);
+    addAndMakeVisible(sweepRateLabel);
+    addAndMakeVisible(sweepDepthLabel);
+    addAndMakeVisible(sweepFollowLabel);
 }
 
 OvocoderAudioProcessorEditor::~OvocoderAudioProcessorEditor()
 {
+    audioProcessor.getStageProfiler().setEnabled(false);
+    audioProcessor.setEnvelopeHistoryEnabled(false);
 }
 
 void OvocoderAudioProcessorEditor::timerCallback() {
-  for (int channel = 0; channel < OvocoderAudioProcessor::numChannels; channel++) {
-    for (int band = 0; band < audioProcessor.getNumBands(); band++) {
-      bandEnvelopes[channel][band] = audioProcessor.getEnvelopeValue(channel, band);
-      mainBandEnvelopes[channel][band] = audioProcessor.getMainInputEnvelopeValue(channel, band);
-      outputBandEnvelopes[channel][band] = audioProcessor.getOutputEnvelopeValue(channel, band);
+  // On a torn read the previous frame is kept; the next tick catches up.
+  if (audioProcessor.getMeteringFrame(incomingMeteringFrame)) {
+    std::swap(meteringFrame, incomingMeteringFrame);
+  }
+
+  // Loads stay at zero until the cycle counter has been calibrated.
+  StageProfiler::Frame frame;
+  if (audioProcessor.getStageProfiler().drain(frame) > 0 && audioProcessor.getSampleRate() > 0 && CycleCounter::isCalibrated()) {
+    double deadline = frame.numSamples / audioProcessor.getSampleRate();
+    dspLoad = CycleCounter::ticksToSeconds(frame.totalTicks) / deadline;
+    for (int stage = 0; stage < StageProfiler::numStages; stage++) {
+      stageLoads[stage] = CycleCounter::ticksToSeconds(frame.stageTicks[stage]) / deadline;
+    }
+  }
+
+  // Only the pieces whose pixels actually move get repainted.
+  bool changed = drainEnvelopeHistory();
+  int numBands = juce::jmax(1, meteringFrame.numBands);
+  int height = meterBottom;
+
+  if (numBands != paintedNumBands || displayedChannel != paintedChannel) {
+    paintedNumBands = numBands;
+    paintedChannel = displayedChannel;
+    for (int i = 0; i < numBands; i++) {
+      updateBarHeights(i);
+    }
+    repaint();
+    changed = true;
+  } else {
+    for (int i = 0; i < numBands; i++) {
+      int previousTop = juce::jmax(barHeights[0][i], barHeights[1][i], barHeights[2][i]);
+      if (updateBarHeights(i)) {
+        int top = juce::jmax(previousTop, barHeights[0][i], barHeights[1][i], barHeights[2][i]);
+        repaint(getBandColumn(i, numBands).withTop(height - top).withBottom(height));
+        changed = true;
+      }
     }
   }
 
-  repaint();
+  int width = juce::roundToInt(correlationArea.getWidth() * meteringFrame.correlation[displayedChannel]);
+  if (width != correlationWidth) {
+    correlationWidth = width;
+    repaint(correlationArea);
+    changed = true;
+  }
+
+  // Tenths of a percent, as displayed.
+  int load = juce::roundToInt(dspLoad * 1000.0f);
+  int activeBands = meteringFrame.activeBands[displayedChannel];
+  if (load != paintedDspLoad || activeBands != paintedActiveBands) {
+    paintedDspLoad = load;
+    paintedActiveBands = activeBands;
+    repaint(dspLoadArea);
+    changed = true;
+  }
+
+  // Drop to a low frame rate while nothing moves, come back on the first change.
+  idleTicks = changed ? 0 : idleTicks + 1;
+  int frameRate = idleTicks > activeFrameRate ? idleFrameRate : activeFrameRate;
+  if (getTimerInterval() != 1000 / frameRate) {
+    startTimer(1000 / frameRate);
+  }
 }
 
-//==============================================================================
-void OvocoderAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-    g.setColour(mainColour);
+bool OvocoderAudioProcessorEditor::updateBarHeights(int band) {
+  int heights[3] = {
+    (int) (400 * meteringFrame.getEnvelopes(DspStateArena::mainInputFollower, displayedChannel)[band]),
+    (int) (400 * meteringFrame.getEnvelopes(DspStateArena::outputFollower, displayedChannel)[band]),
+    (int) (400 * meteringFrame.getEnvelopes(DspStateArena::sidechainFollower, displayedChannel)[band])
+  };
+  bool changed = false;
+  for (int layer = 0; layer < 3; layer++) {
+    changed = changed || heights[layer] != barHeights[layer][band];
+    barHeights[layer][band] = heights[layer];
+  }
+  return changed;
+}
 
-    int numBands = audioProcessor.getNumBands();
+// The bars share the full width; the gaps between them narrow, then close,
+// as the band count grows, and a bar is never narrower than a pixel.
+juce::Rectangle<int> OvocoderAudioProcessorEditor::getBandColumn(int band, int numBands) const {
+  int gap = numBands <= 64 ? 5 : numBands <= 128 ? 1 : 0;
+  int left = band * (getWidth() + gap) / numBands;
+  int right = (band + 1) * (getWidth() + gap) / numBands - gap;
+  return { left, 0, juce::jmax(1, right - left), meterBottom };
+}
 
-    juce::Rectangle<int> bounds = getLocalBounds();
-    int gap = 5;
-    int barWidth = (bounds.getWidth() - (numBands - 1) * gap) / numBands;
+bool OvocoderAudioProcessorEditor::drainEnvelopeHistory() {
+  const double columnSamples = historyColumnSeconds * audioProcessor.getSampleRate();
+  bool changed = false;
 
-    for (int i = 0; i < numBands; i++) {
-      int height = 400 * mainBandEnvelopes[displayedChannel][i];
-      g.fillRect(i * barWidth + (i > 0 ? i : 0) * gap, bounds.getHeight() - height, barWidth, height);
+  while (audioProcessor.popEnvelopeHistory(historyFrame)) {
+    if (columnSamples <= 0.0) {
+      continue;
     }
 
-    g.setColour(outputColour);
+    historyPeak.numBands = historyFrame.numBands;
+    for (int channel = 0; channel < 2; channel++) {
+      float* peak = historyPeak.getEnvelopes(channel);
+      const float* envelopes = historyFrame.getEnvelopes(channel);
+      for (int band = 0; band < historyFrame.numBands; band++) {
+        peak[band] = juce::jmax(peak[band], envelopes[band]);
+      }
+    }
 
-    for (int i = 0; i < numBands; i++) {
-      int height = 400 * outputBandEnvelopes[displayedChannel][i];
-      g.fillRect(i * barWidth + (i > 0 ? i : 0) * gap, bounds.getHeight() - height, barWidth, height);
+    // A block longer than a column fills several with the same peak.
+    historyPeakSamples += historyFrame.numSamples;
+    if (historyPeakSamples >= columnSamples) {
+      for (; historyPeakSamples >= columnSamples; historyPeakSamples -= columnSamples) {
+        changed = historyView.addColumn(historyPeak, displayedChannel) || changed;
+      }
+      std::fill(historyPeak.envelopes.begin(), historyPeak.envelopes.end(), 0.0f);
     }
+  }
 
-    g.setColour(sidechainColour);
-    
-    for (int i = 0; i < numBands; i++) {
-      int height = 400 * bandEnvelopes[displayedChannel][i];
-      g.fillRect(i * barWidth + (i > 0 ? i : 0) * gap, bounds.getHeight() - height, barWidth, 5);
+  if (changed) {
+    historyView.repaint();
+  }
+  return changed;
+}
+
+void OvocoderAudioProcessorEditor::renderStaticLayer() {
+  float scale = juce::getApproximateScaleFactorForComponent(this);
+  staticLayer = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)), juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+
+  juce::Graphics g(staticLayer);
+  g.addTransform(juce::AffineTransform::scale(scale));
+  g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+  juce::Rectangle<int> legendSection = getLocalBounds();
+  legendSection.removeFromTop(260);
+  legendSection.removeFromLeft(400);
+
+  g.setColour(mainColour);
+  g.fillRect(legendSection.getX(), legendSection.getY(), legendRectSize, legendRectSize);
+  g.setColour(juce::Colours::white);
+  g.drawText("Input", legendSection.getX() + legendRectSize + legendRectTextGap, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
+
+  g.setColour(sidechainColour);
+  g.fillRect(legendSection.getX() + 70, legendSection.getY(), legendRectSize, legendRectSize);
+  g.setColour(juce::Colours::white);
+  g.drawText("Sidechain", legendSection.getX() + legendRectSize + legendRectTextGap + 70, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
+
+  g.setColour(outputColour);
+  g.fillRect(legendSection.getX() + 70 + 95, legendSection.getY(), legendRectSize, legendRectSize);
+  g.setColour(juce::Colours::white);
+  g.drawText("Output", legendSection.getX() + legendRectSize + legendRectTextGap + 70 + 95, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
+}
+
+void OvocoderAudioProcessorEditor::paintDspLoad(juce::Graphics& g) {
+  juce::Rectangle<int> area = dspLoadArea.withHeight(20);
+  g.setColour(juce::Colours::black);
+  g.fillRect(area);
+
+  // The full bar width is the whole block deadline.
+  int x = area.getX();
+  for (int stage = 0; stage < StageProfiler::numStages; stage++) {
+    int width = juce::jmin(area.getRight() - x, juce::roundToInt(area.getWidth() * stageLoads[stage]));
+    g.setColour(juce::Colour::fromHSV((float) stage / StageProfiler::numStages, 0.6f, 0.85f, 1.0f));
+    g.fillRect(x, area.getY(), width, area.getHeight());
+    x += width;
+  }
+
+  g.setColour(juce::Colours::white);
+  g.setFont(12.0f);
+  g.drawText("DSP load " + juce::String(dspLoad * 100.0f, 1) + "% of deadline, "
+             + juce::String(meteringFrame.activeBands[displayedChannel]) + "/" + juce::String(paintedNumBands) + " bands active",
+             area.getX(), area.getBottom() + 2, area.getWidth(), 14, juce::Justification::left);
+
+  int columnWidth = area.getWidth() / 3;
+  for (int stage = 0; stage < StageProfiler::numStages; stage++) {
+    g.setColour(juce::Colour::fromHSV((float) stage / StageProfiler::numStages, 0.6f, 0.85f, 1.0f));
+    g.drawText(juce::String(StageProfiler::getStageName(stage)) + " " + juce::String(stageLoads[stage] * 100.0f, 1) + "%",
+               area.getX() + (stage % 3) * columnWidth, area.getBottom() + 16 + (stage / 3) * 14, columnWidth, 14, juce::Justification::left);
+  }
+}
+
+//==============================================================================
+void OvocoderAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // The background and legend come from the cached layer; only the meters
+    // are drawn live, and usually only inside the small regions
+    // timerCallback invalidated.
+    g.drawImage(staticLayer, getLocalBounds().toFloat());
+
+    int numBands = paintedNumBands;
+    int height = meterBottom;
+
+    const juce::Colour layerColours[3] = { mainColour, outputColour, sidechainColour };
+    for (int layer = 0; layer < 3; layer++) {
+      g.setColour(layerColours[layer]);
+      for (int i = 0; i < numBands; i++) {
+        juce::Rectangle<int> column = getBandColumn(i, numBands);
+        if (! g.clipRegionIntersects(column)) {
+          continue;
+        }
+        int barHeight = barHeights[layer][i];
+        // The sidechain envelope is drawn as a marker on top of the bars.
+        g.fillRect(column.getX(), height - barHeight, column.getWidth(), layer == 2 ? 5 : barHeight);
+      }
     }
 
-    int correlationWidth = 225 * audioProcessor.getCorrelationValue(displayedChannel);
-    g.setColour(juce::Colours::black);
-    g.fillRect(0, 140, 225, 20);
-    g.setColour(mainColour);
-    g.fillRect(0, 140, correlationWidth, 20);
-
-    
-    juce::Rectangle<int> legendSection = getLocalBounds();
-    legendSection.removeFromTop(140);
-    legendSection.removeFromLeft(400);
-
-    g.setColour(mainColour);
-    g.fillRect(legendSection.getX(), legendSection.getY(), legendRectSize, legendRectSize);
-    g.setColour(juce::Colours::white);
-    g.drawText("Input", legendSection.getX() + legendRectSize + legendRectTextGap, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
-
-    g.setColour(sidechainColour);
-    g.fillRect(legendSection.getX() + 70, legendSection.getY(), legendRectSize, legendRectSize);
-    g.setColour(juce::Colours::white);
-    g.drawText("Sidechain", legendSection.getX() + legendRectSize + legendRectTextGap + 70, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
-
-    g.setColour(outputColour);
-    g.fillRect(legendSection.getX() + 70 + 95, legendSection.getY(), legendRectSize, legendRectSize);
-    g.setColour(juce::Colours::white);
-    g.drawText("Output", legendSection.getX() + legendRectSize + legendRectTextGap + 70 + 95, legendSection.getY(), legendTextWidth, legendRectSize, juce::Justification::left);
+    if (g.clipRegionIntersects(correlationArea)) {
+      g.setColour(juce::Colours::black);
+      g.fillRect(correlationArea);
+      g.setColour(mainColour);
+      g.fillRect(correlationArea.withWidth(correlationWidth));
+    }
+
+    if (g.clipRegionIntersects(dspLoadArea)) {
+      paintDspLoad(g);
+    }
 }
 
 void OvocoderAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    historyView.setBounds(getLocalBounds().withTop(meterBottom));
+    renderStaticLayer();
 }
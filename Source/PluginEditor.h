@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "EnvelopeHistoryView.h"
 
 //==============================================================================
 /**
@@ -31,12 +32,52 @@ private:
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OvocoderAudioProcessorEditor)
 
-    float bandEnvelopes[2][OvocoderAudioProcessor::maxBands];
-    float mainBandEnvelopes[2][OvocoderAudioProcessor::maxBands];
-    float outputBandEnvelopes[2][OvocoderAudioProcessor::maxBands];
+    // A tick reads into incomingMeteringFrame and swaps it in only when the
+    // read was consistent.
+    OvocoderAudioProcessor::MeteringFrame meteringFrame;
+    OvocoderAudioProcessor::MeteringFrame incomingMeteringFrame;
 
     void timerCallback() override;
 
+    // DSP load per profiler stage and in total, as a fraction of the block deadline.
+    float stageLoads[StageProfiler::numStages] = {};
+    float dspLoad = 0.0f;
+    void paintDspLoad(juce::Graphics& g);
+
+    // Background and legend, rendered once per size at the display scale.
+    juce::Image staticLayer;
+    void renderStaticLayer();
+
+    // Pixel heights of the main, output and sidechain layers as last
+    // invalidated; paint draws exactly these.
+    int barHeights[3][OvocoderAudioProcessor::maxBands] = {};
+    int paintedNumBands = 0;
+    int paintedChannel = 0;
+    int correlationWidth = 0;
+    int paintedDspLoad = -1;
+    int paintedActiveBands = -1;
+    bool updateBarHeights(int band);
+    juce::Rectangle<int> getBandColumn(int band, int numBands) const;
+
+    // The bars stand on meterBottom; the history view fills the strip below.
+    static constexpr int meterBottom = 720;
+    EnvelopeHistoryView historyView;
+    OvocoderAudioProcessor::EnvelopeHistoryFrame historyFrame;
+    bool drainEnvelopeHistory();
+
+    // One history column per historyColumnSeconds of audio, whatever the
+    // host block size; a column shows the peak of the blocks that fell into it.
+    static constexpr double historyColumnSeconds = 0.01;
+    OvocoderAudioProcessor::EnvelopeHistoryFrame historyPeak;
+    double historyPeakSamples = 0.0;
+
+    juce::Rectangle<int> correlationArea { 0, 260, 225, 20 };
+    juce::Rectangle<int> dspLoadArea { 700, 260, 290, 60 };
+
+    static constexpr int activeFrameRate = 30;
+    static constexpr int idleFrameRate = 5;
+    int idleTicks = 0;
+
     juce::Slider 
       attackSlider,
       releaseSlider,
@@ -47,9 +88,17 @@ private:
       numBandsSlider,
       minFreqSlider,
       maxFreqSlider,
-      processedGainSlider;
+      processedGainSlider,
+      formantShiftSlider,
+      formantWarpSlider,
+      morphSlider,
+      sweepRateSlider,
+      sweepDepthSlider,
+      sweepFollowSlider;
+
+    juce::ComboBox morphTargetBox, filterEngineBox;
 
-    juce::ToggleButton correlationEnabledButton;
+    juce::ToggleButton correlationEnabledButton, bypassButton;
 
     juce::Colour mainColour = juce::Colour(200, 200, 66);
     juce::Colour sidechainColour = juce::Colour(58, 165, 170);
@@ -65,9 +114,19 @@ private:
       numBandsSliderAttachment,
       minFreqSliderAttachment,
       maxFreqSliderAttachment,
-      processedGainSliderAttachment;
+      processedGainSliderAttachment,
+      formantShiftSliderAttachment,
+      formantWarpSliderAttachment,
+      morphSliderAttachment,
+      sweepRateSliderAttachment,
+      sweepDepthSliderAttachment,
+      sweepFollowSliderAttachment;
+
+    // Created once the choices are in the boxes, so that the attachments can
+    // select the current ones.
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> morphTargetBoxAttachment, filterEngineBoxAttachment;
 
-    juce::AudioProcessorValueTreeState::ButtonAttachment correlationEnabledButtonAttachment;
+    juce::AudioProcessorValueTreeState::ButtonAttachment correlationEnabledButtonAttachment, bypassButtonAttachment;
 
     juce::Label 
       attackLabel,
@@ -80,7 +139,16 @@ private:
       numBandsLabel,
       minFreqLabel,
       maxFreqLabel,
-      processedGainLabel;
+      processedGainLabel,
+      formantShiftLabel,
+      formantWarpLabel,
+      morphLabel,
+      morphTargetLabel,
+      bypassButtonLabel,
+      filterEngineLabel,
+      sweepRateLabel,
+      sweepDepthLabel,
+      sweepFollowLabel;
 
     int displayedChannel = 0;
 
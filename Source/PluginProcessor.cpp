@@ -8,8 +8,9 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeGuard.h"
 
-juce::AudioProcessorValueTreeState::ParameterLayout OvocoderAudioProcessor::createParameterLayout() {
+juce::AudioProcessorValueTreeState::ParameterLayout OvocoderAudioProcessor::createParameterLayout(const Limits& limits) {
     juce::AudioProcessorValueTreeState::ParameterLayout parameterLayout(
         std::make_unique<juce::AudioParameterFloat>
         (
@@ -39,14 +40,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout OvocoderAudioProcessor::crea
             "order", 
             "Order", 
             1,
-            8,
+            limits.maxOrder,
             2
         ),
         std::make_unique<juce::AudioParameterFloat>
         (
             "num_bands",
             "Bands",
-            juce::NormalisableRange<float>(3.0f, 64.0f, 1.0f, 0.449f),
+            juce::NormalisableRange<float>(3.0f, (float) limits.maxBands, 1.0f, 0.449f),
             8.0f
         ),
         std::make_unique<juce::AudioParameterFloat>
@@ -89,12 +90,87 @@ juce::AudioProcessorValueTreeState::ParameterLayout OvocoderAudioProcessor::crea
             "Processed gain", 
             juce::NormalisableRange(0.0f, 40.0f, 0.01f, 0.2f),
             0.0f
+        ),
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "formant_shift",
+            "Formant shift",
+            juce::NormalisableRange<float>(-24.0f, 24.0f, 0.01f),
+            0.0f
+        ),
+        // Skewed so that 1 (no warp) sits in the middle of the range.
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "formant_warp",
+            "Formant warp",
+            juce::NormalisableRange<float>(0.5f, 2.0f, 0.001f, 0.6309f),
+            1.0f
+        ),
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "morph",
+            "Morph",
+            juce::NormalisableRange<float>(0.0f, 1.0f, 0.001f),
+            0.0f
+        ),
+        std::make_unique<juce::AudioParameterChoice>
+        (
+            "morph_target",
+            "Morph target",
+            PresetBank::getFactoryPresetNames(),
+            0
+        ),
+        std::make_unique<juce::AudioParameterBool>
+        (
+            "bypass",
+            "Bypass",
+            false
+        ),
+        std::make_unique<juce::AudioParameterChoice>
+        (
+            "filter_engine",
+            "Filter engine",
+            juce::StringArray { "Biquad", "State variable" },
+            0
+        ),
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "sweep_rate",
+            "Sweep rate",
+            juce::NormalisableRange<float>(0.01f, 20.0f, 0.01f, 0.3f),
+            0.5f,
+            juce::RangedAudioParameterAttributes<juce::AudioParameterFloatAttributes, float>().withLabel("Hz")
+        ),
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "sweep_depth",
+            "Sweep depth",
+            juce::NormalisableRange<float>(0.0f, 24.0f, 0.01f),
+            0.0f
+        ),
+        std::make_unique<juce::AudioParameterFloat>
+        (
+            "sweep_follow",
+            "Sweep follow",
+            juce::NormalisableRange<float>(-24.0f, 24.0f, 0.01f),
+            0.0f
         )
     );
     return parameterLayout;
 }
+OvocoderAudioProcessor::Limits OvocoderAudioProcessor::Limits::fromEnvironment() {
+    Limits limits;
+    auto maxBandsText = juce::SystemStats::getEnvironmentVariable("OVOCODER_MAX_BANDS", {});
+    if (maxBandsText.isNotEmpty())
+        limits.maxBands = juce::jlimit(limits.maxBands, MAX_BANDS, maxBandsText.getIntValue());
+    auto maxOrderText = juce::SystemStats::getEnvironmentVariable("OVOCODER_MAX_ORDER", {});
+    if (maxOrderText.isNotEmpty())
+        limits.maxOrder = juce::jlimit(limits.maxOrder, MAX_ORDER, maxOrderText.getIntValue());
+    return limits;
+}
+
 //==============================================================================
-OvocoderAudioProcessor::OvocoderAudioProcessor()
+OvocoderAudioProcessor::OvocoderAudioProcessor(Limits _limits)
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
@@ -109,7 +185,8 @@ OvocoderAudioProcessor::OvocoderAudioProcessor()
 #else
     :
 #endif
-        apvts(*this, nullptr, "parameters", createParameterLayout())
+        apvts(*this, nullptr, "parameters", createParameterLayout(_limits)),
+        limits(_limits)
 {
     apvts.addParameterListener("attack", this);
     apvts.addParameterListener("release", this);
@@ -122,6 +199,29 @@ OvocoderAudioProcessor::OvocoderAudioProcessor()
     apvts.addParameterListener("min_freq", this);
     apvts.addParameterListener("max_freq", this);
     apvts.addParameterListener("proc_gain", this);
+    apvts.addParameterListener("formant_shift", this);
+    apvts.addParameterListener("formant_warp", this);
+    apvts.addParameterListener("morph", this);
+    apvts.addParameterListener("morph_target", this);
+    apvts.addParameterListener("bypass", this);
+    apvts.addParameterListener("filter_engine", this);
+    apvts.addParameterListener("sweep_rate", this);
+    apvts.addParameterListener("sweep_depth", this);
+    apvts.addParameterListener("sweep_follow", this);
+
+    presetBank.resolve(apvts);
+    for (int parameter = 0; parameter < PresetBank::numMorphable; parameter++)
+        morphableValues[parameter] = apvts.getRawParameterValue(PresetBank::morphableParameterIDs[parameter]);
+
+    // Opt-in tracing for investigations inside a host: every instance writes
+    // its own file next to the one named by the environment variable.
+    auto traceFile = juce::SystemStats::getEnvironmentVariable("OVOCODER_TRACE_FILE", {});
+    if (traceFile.isNotEmpty())
+        traceRecorder.start(juce::File(traceFile).getNonexistentSibling());
+
+    auto captureFile = juce::SystemStats::getEnvironmentVariable("OVOCODER_CAPTURE_FILE", {});
+    if (captureFile.isNotEmpty())
+        envelopeCapture.start(juce::File(captureFile).getNonexistentSibling());
 }
 
 OvocoderAudioProcessor::~OvocoderAudioProcessor()
@@ -137,6 +237,18 @@ OvocoderAudioProcessor::~OvocoderAudioProcessor()
     apvts.removeParameterListener("min_freq", this);
     apvts.removeParameterListener("max_freq", this);
     apvts.removeParameterListener("proc_gain", this);
+    apvts.removeParameterListener("formant_shift", this);
+    apvts.removeParameterListener("formant_warp", this);
+    apvts.removeParameterListener("morph", this);
+    apvts.removeParameterListener("morph_target", this);
+    apvts.removeParameterListener("bypass", this);
+    apvts.removeParameterListener("filter_engine", this);
+    apvts.removeParameterListener("sweep_rate", this);
+    apvts.removeParameterListener("sweep_depth", this);
+    apvts.removeParameterListener("sweep_follow", this);
+
+    releaseArenas();
+    releaseCoefficientTable();
 }
 
 //==============================================================================
@@ -172,29 +284,60 @@ bool OvocoderAudioProcessor::isMidiEffect() const
    #endif
 }
 
+// How long the filterbank rings after its input stops, down to the level at
+// which the wet output is below silenceThreshold. A band-pass biquad decays as exp(-pi * f0 / Q * t), so
+// the lowest band is the slowest; each cascaded stage is budgeted the full
+// decay, which over-estimates high orders but never cuts a tail short. The
+// envelope followers add nothing audible: without carrier signal there is
+// nothing for them to scale. A carrier sweep can take the state variable
+// filters' lowest band down by its full depth.
 double OvocoderAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const float sweepDown = svfFiltersEnabled.load() ? sweepDepth.load() + std::abs(sweepFollow.load()) : 0.0f;
+    const double lowestFrequency = juce::jmax(1.0f, juce::jmin(minCenterFreq.load(), maxCenterFreq.load()) / std::exp2(sweepDown / 12.0f));
+    const double decayTimeConstant = qualityFactor.load() / (juce::MathConstants<double>::pi * lowestFrequency);
+    return order.load() * std::log(1.0 / getInputSilenceThreshold()) * decayTimeConstant;
+}
+
+// Taken from the gain targets rather than the smoothed gains, so that it can
+// be asked from any thread. A wet gain below unity leaves the threshold as it
+// is rather than loosening it.
+float OvocoderAudioProcessor::getInputSilenceThreshold() const {
+    const float wetGain = std::sin(mix.load() * juce::MathConstants<float>::halfPi) * processed_gain.load() * gain.load();
+    return silenceThreshold / juce::jmax(1.0f, wetGain);
 }
 
 int OvocoderAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return (int) PresetBank::getFactoryPresets().size();
 }
 
 int OvocoderAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
+// Parameters the preset leaves out go back to their defaults. Once they are
+// all set, the audio thread can take the preset's precomputed band layout.
 void OvocoderAudioProcessor::setCurrentProgram (int index)
 {
+    const auto& presets = PresetBank::getFactoryPresets();
+    if (! juce::isPositiveAndBelow(index, (int) presets.size()))
+        return;
+
+    currentProgram.store(index);
+    const auto& values = presetBank.getValues(index);
+    for (int parameter = 0; parameter < PresetBank::numMorphable; parameter++) {
+        auto* ranged = apvts.getParameter(PresetBank::morphableParameterIDs[parameter]);
+        ranged->setValueNotifyingHost(ranged->convertTo0to1(values[(size_t) parameter]));
+    }
+    pendingPresetLayout.store(index);
 }
 
 const juce::String OvocoderAudioProcessor::getProgramName (int index)
 {
-    return {};
+    const auto& presets = PresetBank::getFactoryPresets();
+    return juce::isPositiveAndBelow(index, (int) presets.size()) ? presets[(size_t) index].name : juce::String();
 }
 
 void OvocoderAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -251,54 +394,244 @@ void OvocoderAudioProcessor::setMix(float _mix) {
     mix.store(_mix);
 }
 
+CoefficientTable::Key OvocoderAudioProcessor::getWantedTableKey() const {
+    return { (double) sampleRate, numBands.load(), minCenterFreq.load(), maxCenterFreq.load(), qualityFactor.load() };
+}
+
 void OvocoderAudioProcessor::updateFilterCoefficients() {
-    const int nb = numBands.load();
-    const float minF = minCenterFreq.load();
-    const float maxF = maxCenterFreq.load();
-    const float Q = qualityFactor.load();
-    for (int channel = 0; channel < numChannels; channel++) {
-        for (int i = 0; i < nb; i++)  {
-            for (int o = 0; o < MAX_ORDER; o++) {
-                float ratio;
-                if (nb == 1) {
-                   ratio = 0.0f;
-                } else {
-                   ratio = static_cast<float>(i) / (nb - 1);
-                }
-                float centerFreq = minF * std::pow(maxF / minF, ratio);
-                Coefficients::Ptr coefficients = Coefficients::makeBandPass(sampleRate, centerFreq, Q);
-                sidechainFilters[channel][i][o].coefficients = coefficients;
-                mainFilters[channel][i][o].coefficients = coefficients;
-            }
-        }
-        Coefficients::Ptr coefficients = Coefficients::makeLowPass(sampleRate, maxFundamentalFreq);
-        correlationDownsampleFilters[channel].coefficients = coefficients;
+    const auto key = getWantedTableKey();
+    if (coefficientTable != nullptr && coefficientTable->getKey() == key)
+        return;
+
+    auto table = coefficientCache->get(key);
+    table->incReferenceCount();
+    releaseCoefficientTable();
+    coefficientTable = table.get();
+}
+
+void OvocoderAudioProcessor::releaseCoefficientTable() {
+    if (coefficientTable != nullptr)
+        coefficientTable->decReferenceCount();
+    coefficientTable = nullptr;
+}
+
+// Audio thread. Offline rendering has no deadline and wants every change to
+// land in the same sub-block each run, so it looks the table up in place.
+void OvocoderAudioProcessor::requestCoefficientTable() {
+    if (isNonRealtime())
+        updateFilterCoefficients();
+    else
+        tableRequested.store(true);
+}
+
+// Audio thread. fresh carries a reference, which passes to coefficientTable.
+// Like the arenas, a table is only taken once the previous replacement has
+// been released.
+bool OvocoderAudioProcessor::swapInTable(CoefficientTable* fresh) {
+    if (retiredTable.load() != nullptr)
+        return false;
+
+    retiredTable.store(coefficientTable);
+    coefficientTable = fresh;
+    return true;
+}
+
+// A table looked up before the latest parameter change (or program change,
+// which installs its own) is stale and goes straight back; the change that
+// made it stale has already raised another request.
+bool OvocoderAudioProcessor::takePendingTable() {
+    if (retiredTable.load() != nullptr)
+        return false;
+
+    auto* fresh = pendingTable.exchange(nullptr);
+    if (fresh == nullptr)
+        return false;
+
+    if (! (fresh->getKey() == getWantedTableKey())) {
+        retiredTable.store(fresh);
+        return false;
     }
+    return swapInTable(fresh);
+}
+
+DspStateArena::Layout OvocoderAudioProcessor::getWantedArenaLayout() const {
+    DspStateArena::Layout layout;
+    layout.sampleRate = sampleRate;
+    layout.numChannels = numChannels;
+    layout.numBands = numBands.load();
+    layout.order = order.load();
+    layout.numSvfSegments = svfFiltersEnabled.load() ? maxSvfSegments : 0;
+    layout.correlationSize = correlationStorageSize;
+    return layout;
+}
+
+// Carries the overlapping state over and returns the arena it replaces.
+DspStateArena* OvocoderAudioProcessor::swapInArena(DspStateArena* fresh) {
+    if (arena != nullptr)
+        fresh->copyStateFrom(*arena);
+    for (int channel = 0; channel < numChannels; channel++)
+        correlationTrackers[channel].setStorage(fresh->getCorrelationStorage(channel));
+    DspStateArena* old = arena.release();
+    arena.reset(fresh);
+    return old;
+}
+
+// Run at the start of every block. A built arena is only taken once the
+// previous one has been freed, so there is never more than one in flight.
+void OvocoderAudioProcessor::updateArena() {
+    if (retiredArena.load() == nullptr)
+        if (auto* fresh = pendingArena.exchange(nullptr))
+            retiredArena.store(swapInArena(fresh));
+
+    const auto wanted = getWantedArenaLayout();
+    if (arena->getLayout() == wanted)
+        return;
+
+    if (isNonRealtime())
+        delete swapInArena(new DspStateArena(wanted));
+    else if (pendingArena.load() == nullptr)
+        arenaRequested.store(true);
+}
+
+void OvocoderAudioProcessor::updateBlockConfiguration() {
+    const auto& layout = arena->getLayout();
+    blockNumBands = juce::jmin(numBands.load(), layout.numBands);
+    // Until the first table arrives, the biquads have no bands to run.
+    if (! svfActive)
+        blockNumBands = coefficientTable != nullptr ? juce::jmin(blockNumBands, coefficientTable->getKey().numBands) : 0;
+    blockOrder = juce::jmin(order.load(), layout.order);
+}
+
+// Arena thread: frees the arena and releases the table the audio thread let
+// go of, then builds or looks up what it asked for. A result that is
+// overtaken by another request replaces the stale pending one.
+int OvocoderAudioProcessor::serviceArena() {
+    delete retiredArena.exchange(nullptr);
+    if (arenaRequested.exchange(false))
+        delete pendingArena.exchange(new DspStateArena(getWantedArenaLayout()));
+
+    if (auto* table = retiredTable.exchange(nullptr))
+        table->decReferenceCount();
+    if (tableRequested.exchange(false)) {
+        auto table = coefficientCache->get(getWantedTableKey());
+        table->incReferenceCount();
+        if (auto* stale = pendingTable.exchange(table.get()))
+            stale->decReferenceCount();
+    }
+    return 10;
+}
+
+// Detaches from the arena thread and frees everything but the current arena.
+void OvocoderAudioProcessor::releaseArenas() {
+    arenaThread->removeTimeSliceClient(&arenaBuilder);
+    delete pendingArena.exchange(nullptr);
+    delete retiredArena.exchange(nullptr);
+    arenaRequested.store(false);
+
+    for (auto* slot : { &pendingTable, &retiredTable })
+        if (auto* table = slot->exchange(nullptr))
+            table->decReferenceCount();
+    tableRequested.store(false);
+}
+
+// Plain value of a morphable parameter with the morph applied; a parameter
+// the target preset leaves out morphs towards its default. Only reads the
+// preset values resolved up front, so it is safe on the audio thread.
+float OvocoderAudioProcessor::getMorphedValue(PresetBank::Morphable parameter, float value) const noexcept {
+    const float amount = morphAmount.load();
+    if (amount <= 0.0f)
+        return value;
+
+    const int target = juce::jlimit(0, presetBank.getNumPresets() - 1, morphTarget.load());
+    return PresetBank::interpolate(parameter, value, presetBank.getValues(target)[(size_t) parameter], amount);
+}
+
+// Takes the coefficients of a program's layout if the parameters in effect
+// still describe it (no morph, no automation since the program change).
+bool OvocoderAudioProcessor::installPresetLayout(const PresetBank::Layout& layout) {
+    auto matches = [] (float a, float b) { return std::abs(a - b) <= 1.0e-4f * std::abs(b); };
+    if (layout.table == nullptr || layout.numBands != numBands.load() || ! matches(minCenterFreq.load(), layout.minFreq)
+        || ! matches(maxCenterFreq.load(), layout.maxFreq) || ! matches(qualityFactor.load(), layout.q))
+        return false;
+
+    // The bank keeps its own reference, so this one is released on the arena
+    // thread like any other.
+    layout.table->incReferenceCount();
+    if (swapInTable(layout.table.get()))
+        return true;
+    layout.table->decReferenceCount();
+    return false;
+}
+
+// The morph parameters re-apply every morphable parameter.
+void OvocoderAudioProcessor::applyAllParameters() {
+    parameterChanged("morph_target", apvts.getRawParameterValue("morph_target")->load());
+    parameterChanged("morph", apvts.getRawParameterValue("morph")->load());
+    parameterChanged("bypass", apvts.getRawParameterValue("bypass")->load());
+    parameterChanged("filter_engine", apvts.getRawParameterValue("filter_engine")->load());
+    parameterChanged("sweep_rate", apvts.getRawParameterValue("sweep_rate")->load());
+    parameterChanged("sweep_depth", apvts.getRawParameterValue("sweep_depth")->load());
+    parameterChanged("sweep_follow", apvts.getRawParameterValue("sweep_follow")->load());
 }
 
 void OvocoderAudioProcessor::parameterChanged(const juce::String & parameterID,float newValue) {
-    if (parameterID == "attack") {
-        setAttackCoeff(newValue);
-    } else if (parameterID == "release") {
-        setReleaseCoeff(newValue);
-    } else if (parameterID == "q") {
-        setFilterQualityFactor(newValue);
-    } else if (parameterID == "order") {
-        setFilterOrder((int)newValue);
-    } else if (parameterID == "gain") {
-        setOutputGain(newValue);
-    } else if (parameterID == "correlation_enabled") {
-        setCorrelationEnabled((bool)newValue);
-    } else if (parameterID == "mix") {
-        setMix(newValue);
-    } else if (parameterID == "num_bands") {
-        setNumBands((int)newValue);
-    } else if (parameterID == "min_freq") {
-        setMinFreq(newValue);
-    } else if (parameterID == "max_freq") {
-        setMaxFreq(newValue);
-    } else if (parameterID == "proc_gain") {
-        setProcessedGain(newValue);
+    if (restoringState.load())
+        return;
+
+    if (parameterID == "morph" || parameterID == "morph_target") {
+        if (parameterID == "morph")
+            morphAmount.store(newValue);
+        else
+            morphTarget.store((int) newValue);
+        for (int parameter = 0; parameter < PresetBank::numMorphable; parameter++)
+            if (PresetBank::isMorphed((PresetBank::Morphable) parameter))
+                applyMorphableParameter((PresetBank::Morphable) parameter, morphableValues[parameter]->load());
+        return;
+    }
+
+    for (int parameter = 0; parameter < PresetBank::numMorphable; parameter++) {
+        if (parameterID == PresetBank::morphableParameterIDs[parameter]) {
+            applyMorphableParameter((PresetBank::Morphable) parameter, newValue);
+            return;
+        }
+    }
+
+    if (parameterID == "bypass") {
+        bypassed.store(newValue >= 0.5f);
+    } else if (parameterID == "filter_engine") {
+        svfFiltersEnabled.store(newValue >= 0.5f);
+    } else if (parameterID == "sweep_rate") {
+        sweepRate.store(newValue);
+    } else if (parameterID == "sweep_depth") {
+        sweepDepth.store(newValue);
+    } else if (parameterID == "sweep_follow") {
+        sweepFollow.store(newValue);
+    }
+}
+
+void OvocoderAudioProcessor::setSvfFiltersEnabled(bool shouldBeEnabled) {
+    auto* engine = apvts.getParameter("filter_engine");
+    engine->setValueNotifyingHost(engine->convertTo0to1(shouldBeEnabled ? 1.0f : 0.0f));
+}
+
+void OvocoderAudioProcessor::applyMorphableParameter(PresetBank::Morphable parameter, float newValue) {
+    newValue = getMorphedValue(parameter, newValue);
+
+    switch (parameter) {
+        case PresetBank::attack:             setAttackCoeff(newValue); break;
+        case PresetBank::release:            setReleaseCoeff(newValue); break;
+        case PresetBank::q:                  setFilterQualityFactor(newValue); break;
+        case PresetBank::order:              setFilterOrder((int)newValue); break;
+        case PresetBank::gain:               setOutputGain(newValue); break;
+        case PresetBank::correlationEnabled: setCorrelationEnabled((bool)newValue); break;
+        case PresetBank::mix:                setMix(newValue); break;
+        case PresetBank::numBands:           setNumBands((int)newValue); break;
+        case PresetBank::minFreq:            setMinFreq(newValue); break;
+        case PresetBank::maxFreq:            setMaxFreq(newValue); break;
+        case PresetBank::procGain:           setProcessedGain(newValue); break;
+        case PresetBank::formantShift:       formantShift.store(newValue); break;
+        case PresetBank::formantWarp:        formantWarp.store(newValue); break;
+        case PresetBank::numMorphable:       break;
     }
 }
 //==============================================================================
@@ -306,61 +639,183 @@ void OvocoderAudioProcessor::prepareToPlay (double _sampleRate, int samplesPerBl
 {
     sampleRate = _sampleRate;
 
-    setReleaseCoeff(apvts.getRawParameterValue("release")->load());
-    setAttackCoeff(apvts.getRawParameterValue("attack")->load());
-    setFilterQualityFactor(apvts.getRawParameterValue("q")->load());
-    setFilterOrder((int)apvts.getRawParameterValue("order")->load());
-    setOutputGain(apvts.getRawParameterValue("gain")->load());
-    setCorrelationEnabled(apvts.getRawParameterValue("correlation_enabled")->load());
-    setMix(apvts.getRawParameterValue("mix")->load());
-    setNumBands((int)apvts.getRawParameterValue("num_bands")->load());
-    setMinFreq(apvts.getRawParameterValue("min_freq")->load());
-    setMaxFreq(apvts.getRawParameterValue("max_freq")->load());
-    setProcessedGain(apvts.getRawParameterValue("proc_gain")->load());
-
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
+    // The state variable filters compute their own coefficients, so no table
+    // is built while they are on; the biquads request one if they come back.
+    applyAllParameters();
+    const bool svfEnabled = svfFiltersEnabled.load();
+    presetBank.prepare(sampleRate, svfEnabled ? nullptr : &coefficientCache.get());
+    pendingPresetLayout.store(-1);
+
+    releaseArenas();
+    for (int channel = 0; channel < numChannels; channel++)
+        correlationTrackers[channel].prepare(sampleRate);
+    correlationStorageSize = correlationTrackers[0].getStorageSize();
+    arena.reset();
+    swapInArena(new DspStateArena(getWantedArenaLayout()));
+
+    if (svfEnabled) {
+        releaseCoefficientTable();
+        filtersDirty.store(true);
+    } else {
+        updateFilterCoefficients();
+        filtersDirty.store(false);
+    }
 
-    for (int channel = 0; channel < numChannels; channel++) {
-        for (int i = 0; i < MAX_BANDS; i++)  {
-            for (int j = 0; j < MAX_ORDER; j++) {
-                sidechainFilters[channel][i][j].prepare(spec);
-                mainFilters[channel][i][j].prepare(spec);
-            }
-        }
-        correlationDownsampleFilters[channel].prepare(spec);
-    }    
+    // Chunks stay a multiple of the correlation decimation so that splitting
+    // an oversized host block does not shift the detector's sampling phase.
+    metricsPublisher.prepare(sampleRate, samplesPerBlock);
+
+    bandHoldSamples = (int) (bandHoldSeconds * sampleRate);
+
+    maxChunkSize = juce::jmin(automationSubBlockSize,
+                              ((samplesPerBlock + AUTOCORRELATION_DOWNSAMPLE - 1) / AUTOCORRELATION_DOWNSAMPLE) * AUTOCORRELATION_DOWNSAMPLE);
+    processBuffer.setSize(2, maxChunkSize);
+    envelopeBuffer.setSize(limits.maxBands, maxChunkSize);
+    bandBuffer.setSize(VocoderDsp::bandGroupSize, maxChunkSize);
+    outputBuffer.setSize(1, maxChunkSize);
+    gainRamps.setSize(2, maxChunkSize);
+    rampSteps.setSize(1, juce::jmax(maxChunkSize, samplesPerBlock));
+    for (int sample = 0; sample < rampSteps.getNumSamples(); sample++)
+        rampSteps.setSample(0, sample, (float) (sample + 1));
+
+    wetGainSmoothed.reset(sampleRate, gainSmoothingSeconds);
+    dryGainSmoothed.reset(sampleRate, gainSmoothingSeconds);
+    updateGainTargets();
+    wetGainSmoothed.setCurrentAndTargetValue(wetGainSmoothed.getTargetValue());
+    dryGainSmoothed.setCurrentAndTargetValue(dryGainSmoothed.getTargetValue());
+
+    svfActive = arena->getLayout().numSvfSegments > 0;
+    minFreqSmoothed.reset(sampleRate, frequencySmoothingSeconds);
+    maxFreqSmoothed.reset(sampleRate, frequencySmoothingSeconds);
+    qSmoothed.reset(sampleRate, frequencySmoothingSeconds);
+    minFreqSmoothed.setCurrentAndTargetValue(minCenterFreq.load());
+    maxFreqSmoothed.setCurrentAndTargetValue(maxCenterFreq.load());
+    qSmoothed.setCurrentAndTargetValue(qualityFactor.load());
+
+    remappedEnvelope.setSize(VocoderDsp::bandGroupSize, maxChunkSize);
+    formantShiftSmoothed.reset(sampleRate, formantSmoothingSeconds);
+    formantWarpSmoothed.reset(sampleRate, formantSmoothingSeconds);
+    formantShiftSmoothed.setCurrentAndTargetValue(formantShift.load());
+    formantWarpSmoothed.setCurrentAndTargetValue(formantWarp.load());
+
+    bypassFade.reset(sampleRate, bypassFadeSeconds);
+    bypassFade.setCurrentAndTargetValue(bypassed.load() ? 1.0f : 0.0f);
+    fullyBypassed = false;
+    bypassPrewarmSamples = (int) (bypassPrewarmSeconds * sampleRate);
+    bypassPrewarmRemaining = 0;
+    bypassDryBuffer.setSize(2, samplesPerBlock);
+    bypassRamp.setSize(1, samplesPerBlock);
+
+    reset();
+    arenaThread->addTimeSliceClient(&arenaBuilder);
+}
+
+void OvocoderAudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+}
+
+// Clears every filter, envelope and correlation state but keeps the current
+// coefficients, so a prepared instance can be reused for a new stream without
+// paying for another updateFilterCoefficients().
+void OvocoderAudioProcessor::reset()
+{
+    resetBandFilters();
+    if (arena != nullptr)
+        arena->clearFollowers();
+
+    std::fill(meteringFrame.envelopes.begin(), meteringFrame.envelopes.end(), 0.0f);
+    for (int channel = 0; channel < 2; channel++) {
+        meteringFrame.activeBands[channel] = 0;
+        meteringFrame.correlation[channel] = 0.0f;
+    }
+    meteringFrame.numBands = numBands.load();
+    publishMeteringFrame();
+
+    analysisPosition = 0;
+    silentSamples = 0;
+    sleeping = false;
+    sweepPhase = 0.0;
+    sweepLevel = 0.0f;
+}
+
+void OvocoderAudioProcessor::publishMeteringFrame() noexcept {
+    static_assert(sizeof(int) == 4 && sizeof(float) == 4, "the metering snapshot is stored in 32-bit words");
+
+    const int frameBands = juce::jlimit(0, limits.maxBands, meteringFrame.numBands);
+    meteringSnapshot.beginWrite();
+    meteringSnapshot.write(0, &frameBands, 1);
+    meteringSnapshot.write(1, meteringFrame.activeBands, 2);
+    meteringSnapshot.write(3, meteringFrame.correlation, 2);
+    for (int row = 0; row < DspStateArena::numFollowers * 2; row++)
+        meteringSnapshot.write(5 + row * limits.maxBands, meteringFrame.envelopes.data() + (size_t) (row * limits.maxBands), frameBands);
+    meteringSnapshot.endWrite();
+}
 
-    maxLag = static_cast<int>(sampleRate / (minFundamentalFreq * AUTOCORRELATION_DOWNSAMPLE));
-    minLag = static_cast<int>(sampleRate / (maxFundamentalFreq * AUTOCORRELATION_DOWNSAMPLE));
-    correlationBufferSize = 2 * maxLag;
+bool OvocoderAudioProcessor::getMeteringFrame(MeteringFrame& frame) const {
+    jassert(frame.maxBands == limits.maxBands);
 
-    correlationBuffer = juce::AudioBuffer<float>(numChannels, correlationBufferSize);
-    correlationLevels = juce::AudioBuffer<float>(numChannels, maxLag - minLag + 1);
-    lagEnergyLevels = juce::AudioBuffer<float>(numChannels, maxLag - minLag + 1);
-    correlationBuffer.clear();
-    correlationLevels.clear();
-    lagEnergyLevels.clear();
+    juce::uint32 sequence;
+    if (! meteringSnapshot.beginRead(sequence))
+        return false;
+
+    // A torn header can hold any count, so it is clamped before it sizes a copy.
+    meteringSnapshot.read(0, &frame.numBands, 1);
+    frame.numBands = juce::jlimit(0, limits.maxBands, frame.numBands);
+    meteringSnapshot.read(1, frame.activeBands, 2);
+    meteringSnapshot.read(3, frame.correlation, 2);
+    for (int row = 0; row < DspStateArena::numFollowers * 2; row++)
+        meteringSnapshot.read(5 + row * limits.maxBands, frame.envelopes.data() + (size_t) (row * limits.maxBands), frame.numBands);
 
-    updateFilterCoefficients();
-    filtersDirty.store(false);
+    return meteringSnapshot.endRead(sequence);
+}
 
-    processBuffer.setSize(numChannels, samplesPerBlock);
-    outputBuffer.setSize(numChannels, samplesPerBlock);
+void OvocoderAudioProcessor::setEnvelopeHistoryEnabled(bool shouldBeEnabled) {
+    if (shouldBeEnabled == envelopeHistoryEnabled.load())
+        return;
 
-    float correlationReleaseInSamples = correlationReleaseInMs * sampleRate / 1000;
-    correlationReleaseCoeff = std::exp(-1 / correlationReleaseInSamples);
+    if (shouldBeEnabled) {
+        envelopeHistory.allocate(envelopeHistorySize, EnvelopeHistoryFrame(limits.maxBands));
+        envelopeHistoryEnabled.store(true);
+        return;
+    }
 
-    float correlationAttackInSamples = correlationAttackInMs * sampleRate / 1000;
-    correlationAttackCoeff = std::exp(-1 / correlationAttackInSamples);
+    envelopeHistoryEnabled.store(false);
+    while (pushingEnvelopeHistory.load())
+        juce::Thread::yield();
+    envelopeHistory.release();
 }
 
-void OvocoderAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+void OvocoderAudioProcessor::resetBandFilters() {
+    if (arena == nullptr)
+        return;
+
+    arena->clearFilterStates();
+    for (int channel = 0; channel < numChannels; channel++)
+        correlationTrackers[channel].reset();
+}
+
+void OvocoderAudioProcessor::setModulatorAnalysis(ModulatorAnalysis* analysis, AnalysisMode mode) {
+    modulatorAnalysis = analysis;
+    analysisMode = analysis != nullptr ? mode : AnalysisMode::live;
+    analysisPosition = 0;
+}
+
+ModulatorAnalysis::Key OvocoderAudioProcessor::getAnalysisKey(int blockSize) const {
+    ModulatorAnalysis::Key key;
+    key.sampleRate = sampleRate;
+    key.blockSize = blockSize;
+    key.numBands = numBands.load();
+    key.order = order.load();
+    key.correlationEnabled = correlationEnabled.load() ? 1 : 0;
+    key.minFreq = minCenterFreq.load();
+    key.maxFreq = maxCenterFreq.load();
+    key.q = qualityFactor.load();
+    key.attackMs = getMorphedValue(PresetBank::attack, apvts.getRawParameterValue("attack")->load());
+    key.releaseMs = getMorphedValue(PresetBank::release, apvts.getRawParameterValue("release")->load());
+    key.filterEngine = svfFiltersEnabled.load() ? 1 : 0;
+    return key;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -391,6 +846,7 @@ bool OvocoderAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void OvocoderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    OVOCODER_REALTIME_SECTION
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -404,9 +860,9 @@ void OvocoderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    juce::AudioBuffer<float> sidechainBuffer = getBusBuffer(buffer, true, 2);
-    juce::AudioBuffer<float> mainBuffer = getBusBuffer(buffer, true, 0);
-    juce::AudioBuffer<float> unvoicedBuffer = getBusBuffer(buffer, true, 1);
+    juce::AudioBuffer<float> sidechainBuffer = getBusBuffer(buffer, true, sidechainBusIndex);
+    juce::AudioBuffer<float> mainBuffer = getBusBuffer(buffer, true, mainBusIndex);
+    juce::AudioBuffer<float> unvoicedBuffer = getBusBuffer(buffer, true, unvoicedBusIndex);
     int numChannels = mainBuffer.getNumChannels();
     int numSamples = mainBuffer.getNumSamples();
 
@@ -416,130 +872,593 @@ void OvocoderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
 
     bool unvoicedBufferActive = unvoicedBuffer.getNumChannels() == numChannels;
 
-    if (filtersDirty.exchange(false))
-        updateFilterCoefficients();
+    // Bypass crossfades between the processed and the dry main input over
+    // bypassFadeSeconds, then leaves the input untouched without running any
+    // DSP. Entering full bypass clears all state. Leaving it first runs the
+    // DSP for bypassPrewarmSeconds with the output still dry, so the filters
+    // and envelopes have warmed up before the fade-in starts.
+    const bool bypassWanted = bypassed.load() || processingBypassed;
+    if (fullyBypassed && ! bypassWanted) {
+        fullyBypassed = false;
+        bypassPrewarmRemaining = bypassPrewarmSamples;
+    }
+    if (bypassWanted)
+        bypassPrewarmRemaining = 0;
+    bypassFade.setTargetValue(bypassWanted || bypassPrewarmRemaining > 0 ? 1.0f : 0.0f);
+    if (numChannels > bypassDryBuffer.getNumChannels())
+        bypassFade.setCurrentAndTargetValue(bypassFade.getTargetValue());
+
+    // A host block longer than prepared for is faded in slices that fit the
+    // dry copy, rather than jumping.
+    const bool bypassChanging = bypassFade.isSmoothing() || bypassFade.getCurrentValue() != bypassFade.getTargetValue()
+                             || bypassPrewarmRemaining > 0;
+    const int bypassSliceSize = bypassDryBuffer.getNumSamples();
+    if (bypassChanging && numSamples > bypassSliceSize && bypassSliceSize > 0) {
+        for (int start = 0; start < numSamples; start += bypassSliceSize) {
+            juce::AudioBuffer<float> slice (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, juce::jmin(bypassSliceSize, numSamples - start));
+            processBlock(slice, midiMessages);
+        }
+        return;
+    }
 
-    const int currentNumBands = numBands.load();
-    const int currentOrder = order.load();
-    const float currentAttackCoeff = attackCoeff.load();
-    const float currentReleaseCoeff = releaseCoeff.load();
-    const float currentGain = gain.load();
-    const float currentProcessedGain = processed_gain.load();
-    const float currentMix = mix.load();
-    const bool  currentCorrelationEnabled = correlationEnabled.load();
+    if (! bypassFade.isSmoothing() && bypassFade.getCurrentValue() >= 1.0f && bypassPrewarmRemaining == 0) {
+        if (! fullyBypassed) {
+            reset();
+            fullyBypassed = true;
+        }
+        return;
+    }
 
-    for (int channel = 0; channel < numChannels; ++channel)
-    {
-        float* sidechainChannelData = sidechainBuffer.getWritePointer(channel);
-        float* mainChannelData = mainBuffer.getWritePointer(channel);
-        float* unvoicedChannelData = unvoicedBufferActive ? unvoicedBuffer.getWritePointer(channel) : nullptr;
-        float* correlationLevelsData = correlationLevels.getWritePointer(channel);
-        float* correlationBufferData = correlationBuffer.getWritePointer(channel);
-        float* lagEnergyData = lagEnergyLevels.getWritePointer(channel);
-        
-        for (int sample = 0; sample < numSamples; sample++) {
-
-            float correlation = 0;
-            float filteredSample = correlationDownsampleFilters[channel].processSample(sidechainChannelData[sample]);
-            if (currentCorrelationEnabled && (sample % AUTOCORRELATION_DOWNSAMPLE == 0)) {
-                int correlationBufferPointer = correlationBufferPointers[channel];
-                int currentWindowEndSample = (correlationBufferPointer - (maxLag - minLag) + correlationBufferSize) % correlationBufferSize;
-                currentWindowEnergyLevels[channel] += filteredSample * filteredSample;
-                currentWindowEnergyLevels[channel] -= correlationBufferData[currentWindowEndSample] * correlationBufferData[currentWindowEndSample];
-
-                float maxCorrelation = 0;
-                for (int lag = minLag; lag <= maxLag; lag++) {
-                    int lagSample = (correlationBufferPointer - lag + correlationBufferSize) % correlationBufferSize;
-                    int currentWindowEndLagSample = (correlationBufferPointer - (maxLag - minLag) - lag + correlationBufferSize) % correlationBufferSize;
-                    correlationLevelsData[lag - minLag] += filteredSample * correlationBufferData[lagSample];
-                    correlationLevelsData[lag - minLag] -= correlationBufferData[currentWindowEndSample] * correlationBufferData[currentWindowEndLagSample];
-                    lagEnergyData[lag - minLag] += correlationBufferData[lagSample] * correlationBufferData[lagSample];
-                    lagEnergyData[lag - minLag] -= correlationBufferData[currentWindowEndLagSample] * correlationBufferData[currentWindowEndLagSample];
-                    float energy = currentWindowEnergyLevels[channel] * lagEnergyData[lag - minLag];
-                    float lagCorrelation;
-                    if (energy > 1e-10f) {
-                        lagCorrelation = std::abs(correlationLevelsData[lag - minLag]) / std::sqrt(energy);
-                    } else {
-                        lagCorrelation = 0.0f;
-                    }
-                    if (lagCorrelation > maxCorrelation) {
-                        maxCorrelation = lagCorrelation;
-                    }
-                }
-
-                correlationBufferData[correlationBufferPointer] = filteredSample;
-                correlationBufferPointers[channel] = ((correlationBufferPointer + 1) % correlationBufferSize);
-
-                correlation = std::pow(juce::jlimit(0.0f, 1.0f, (maxCorrelation - 0.5f) * 2), 2.0f);
-
-                if (correlation > lastCorrelation[channel]) {
-                    lastCorrelation[channel] += (correlation - lastCorrelation[channel]) * (1 - correlationAttackCoeff);
-                } else {
-                    lastCorrelation[channel] += (correlation - lastCorrelation[channel]) * (1 - correlationReleaseCoeff);
-                }
-                
-                correlationValues[channel].store(lastCorrelation[channel]);
+    // While prewarming, the fade sits at fully dry, so the ramp is all ones.
+    const bool bypassFading = bypassFade.isSmoothing() || bypassPrewarmRemaining > 0;
+    if (bypassFading) {
+        for (int channel = 0; channel < numChannels; channel++)
+            bypassDryBuffer.copyFrom(channel, 0, mainBuffer, channel, 0, numSamples);
+        fillRamp(bypassFade, bypassRamp.getWritePointer(0), numSamples);
+    }
+    bypassPrewarmRemaining = juce::jmax(0, bypassPrewarmRemaining - numSamples);
+
+    const auto metricsStartTicks = metricsPublisher.isPublishing() ? juce::Time::getHighResolutionTicks() : 0;
+    stageProfiler.beginBlock(numSamples);
+    traceRecorder.beginBlock(numSamples, numBands.load(), order.load());
+    auto stageMark = stageProfiler.mark();
+
+    updateArena();
+
+    // The state variable filters need no rebuild; filtersDirty stays set so
+    // the biquads catch up if they are switched back in. Switching engines
+    // restarts the band filters from rest, and waits for an arena with room
+    // for the state variable coefficients.
+    const bool svfWanted = svfFiltersEnabled.load() && arena->getLayout().numSvfSegments > 0;
+    if (svfWanted != svfActive) {
+        svfActive = svfWanted;
+        resetBandFilters();
+    }
+
+    // A program change comes with its precomputed layout, which replaces the
+    // rebuild when the parameters still match it.
+    const int presetLayout = pendingPresetLayout.exchange(-1);
+    if (presetLayout >= 0 && ! svfActive && installPresetLayout(presetBank.getLayout(presetLayout)))
+        filtersDirty.store(false);
+
+    if (! svfActive) {
+        if (filtersDirty.exchange(false)) {
+            TraceRecorder::Scope traceScope (traceRecorder, "coefficientUpdate");
+            requestCoefficientTable();
+        }
+        takePendingTable();
+    }
+
+    stageProfiler.addSince(StageProfiler::coefficientUpdate, stageMark);
+
+    updateBlockConfiguration();
+    const int currentNumBands = blockNumBands;
+
+    // Silence sleep: once every input has been below the input threshold for
+    // longer than the tail, the wet signal is inaudible and the filterbank
+    // is skipped until a block with signal arrives. Offline analysis modes
+    // never sleep, their streams need every block.
+    const float inputSilenceThreshold = getInputSilenceThreshold();
+    const bool inputSilent = silenceSleepEnabled.load() && modulatorAnalysis == nullptr
+                          && isSilent(mainBuffer, inputSilenceThreshold) && isSilent(sidechainBuffer, inputSilenceThreshold)
+                          && (! unvoicedBufferActive || isSilent(unvoicedBuffer, inputSilenceThreshold));
+    if (! inputSilent) {
+        sleeping = false;
+        silentSamples = 0;
+    } else {
+        if (! sleeping && silentSamples >= (juce::int64) (getTailLengthSeconds() * sampleRate))
+            enterSleep();
+        silentSamples += numSamples;
+    }
+
+    if (sleeping) {
+        sleepBlock(mainBuffer, numSamples);
+    } else {
+        for (int offset = 0; offset < numSamples; offset += maxChunkSize) {
+            const int chunkSamples = juce::jmin(maxChunkSize, numSamples - offset);
+
+            // Coefficient changes that arrived during the block, and tables
+            // the arena thread finished meanwhile, take effect at the next
+            // sub-block boundary.
+            if (offset > 0 && ! svfActive) {
+                stageMark = stageProfiler.mark();
+                const bool requested = filtersDirty.exchange(false);
+                if (requested)
+                    requestCoefficientTable();
+                if (takePendingTable() || requested)
+                    updateBlockConfiguration();
+                stageProfiler.addSince(StageProfiler::coefficientUpdate, stageMark);
             }
 
-            float voicedGain = 1.0f, unvoicedGain = 0.0f;
-            if (currentCorrelationEnabled && unvoicedBufferActive) {
-                float angle = lastCorrelation[channel] * juce::MathConstants<float>::halfPi;
-                voicedGain = std::sin(angle);
-                unvoicedGain = std::cos(angle);
+            updateGainTargets();
+            fillGainRamps(chunkSamples);
+            if (svfActive)
+                updateSvfCoefficients(chunkSamples);
+            updateFormantRemap(chunkSamples);
+            updateMorphGains();
+
+            for (int channel = 0; channel < numChannels; ++channel) {
+                const float* unvoicedChannelData = unvoicedBufferActive ? unvoicedBuffer.getReadPointer(channel) + offset : nullptr;
+                processChunk(sidechainBuffer.getReadPointer(channel) + offset,
+                             mainBuffer.getWritePointer(channel) + offset,
+                             unvoicedChannelData,
+                             gainRamps.getReadPointer(0),
+                             gainRamps.getReadPointer(1),
+                             channel,
+                             chunkSamples,
+                             analysisPosition + offset);
             }
+        }
+    }
+    analysisPosition += numSamples;
+
+    // One consistent metering frame per block instead of a store per band.
+    traceRecorder.begin("metering");
+    stageMark = stageProfiler.mark();
+    meteringFrame.numBands = currentNumBands;
+    const size_t bandBytes = sizeof(float) * (size_t) currentNumBands;
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (auto follower : { DspStateArena::sidechainFollower, DspStateArena::mainInputFollower, DspStateArena::outputFollower })
+            std::memcpy(meteringFrame.getEnvelopes(follower, channel), arena->getEnvelopes(follower, channel), bandBytes);
+    }
+    publishMeteringFrame();
+
+    // Same handshake as the trace recorder: setEnvelopeHistoryEnabled(false)
+    // either sees this block pushing or this block sees history disabled.
+    if (envelopeHistoryEnabled.load(std::memory_order_relaxed)) {
+        pushingEnvelopeHistory.store(true);
+        if (envelopeHistoryEnabled.load()) {
+            envelopeHistoryFrame.numBands = currentNumBands;
+            envelopeHistoryFrame.numSamples = numSamples;
+            for (int channel = 0; channel < numChannels; channel++)
+                std::memcpy(envelopeHistoryFrame.getEnvelopes(channel), meteringFrame.getEnvelopes(DspStateArena::sidechainFollower, channel), bandBytes);
+            envelopeHistory.push(envelopeHistoryFrame);
+        }
+        pushingEnvelopeHistory.store(false);
+    }
+    const float* capturedEnvelopes[] = { meteringFrame.getEnvelopes(DspStateArena::sidechainFollower, 0),
+                                         meteringFrame.getEnvelopes(DspStateArena::sidechainFollower, 1) };
+    envelopeCapture.push(numSamples, getSampleRate(), numChannels, currentNumBands, meteringFrame.correlation, capturedEnvelopes);
+    stageProfiler.addSince(StageProfiler::metering, stageMark);
+    traceRecorder.end("metering");
+
+    if (bypassFading) {
+        const float* ramp = bypassRamp.getReadPointer(0);
+        for (int channel = 0; channel < numChannels; channel++) {
+            float* mainChannelData = mainBuffer.getWritePointer(channel);
+            const float* dryData = bypassDryBuffer.getReadPointer(channel);
+            for (int sample = 0; sample < numSamples; sample++)
+                mainChannelData[sample] += (dryData[sample] - mainChannelData[sample]) * ramp[sample];
+        }
+    }
+
+    stageProfiler.endBlock();
+    traceRecorder.endBlock();
 
-            float sumMainSample = 0.0f;
-
-            for (int band = 0; band < currentNumBands; band++) {
-                float processedSidechainSample = sidechainChannelData[sample];
-                for (int o = 0; o < currentOrder; o++) {
-                    processedSidechainSample = sidechainFilters[channel][band][o].processSample(processedSidechainSample);
-                }
-                float absoluteProcessedSidechainValue = std::abs(processedSidechainSample);
-                float envelopeState = envelopeStates[channel][band];
-
-                if (absoluteProcessedSidechainValue > envelopeState) {
-                    envelopeStates[channel][band] += (absoluteProcessedSidechainValue - envelopeState) * (1.0f - currentAttackCoeff);
-                } else {
-                    envelopeStates[channel][band] -= (envelopeState - absoluteProcessedSidechainValue) * (1.0f - currentReleaseCoeff);
-                }
-
-                float processedSample = mainChannelData[sample] * voicedGain + (unvoicedChannelData != nullptr ? unvoicedChannelData[sample] * unvoicedGain : 0.0f);
-                for (int o = 0; o < currentOrder; o++) {
-                    processedSample = mainFilters[channel][band][o].processSample(processedSample);
-                }
-
-                float absoluteProcessedSample = std::abs(processedSample);
-                float mainEnvelopeState = mainInputEnvelopeStates[channel][band];
-                if (absoluteProcessedSample > mainEnvelopeState) {
-                    mainInputEnvelopeStates[channel][band] += (absoluteProcessedSample - mainEnvelopeState) * (1.0f - currentAttackCoeff);
-                } else {
-                    mainInputEnvelopeStates[channel][band] -= (mainEnvelopeState - absoluteProcessedSample) * (1.0f - currentReleaseCoeff);
-                }
-
-                float appliedEnvelopeSample = processedSample * envelopeStates[channel][band];
-                float absoluteAppliedEnvelopeSample = std::abs(appliedEnvelopeSample);
-
-                float outputEnvelopeState = outputEnvelopeStates[channel][band];
-                if (absoluteAppliedEnvelopeSample > outputEnvelopeState) {
-                    outputEnvelopeStates[channel][band] += (absoluteAppliedEnvelopeSample - outputEnvelopeState) * (1.0f - currentAttackCoeff);
-                } else {
-                    outputEnvelopeStates[channel][band] -= (outputEnvelopeState - absoluteAppliedEnvelopeSample) * (1.0f - currentReleaseCoeff);
-                }
-
-                sumMainSample += appliedEnvelopeSample;
+    if (metricsPublisher.isPublishing()) {
+        const double processSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - metricsStartTicks);
+        metricsPublisher.publish(numSamples, processSeconds, currentNumBands, order.load(), correlationEnabled.load());
+    }
+
+}
+
+// A band is suspended once its sidechain envelope times carrierLevel has
+// stayed below threshold (bandActivityThreshold over the wet gain) for
+// bandHoldSamples, and resumes on the first chunk that reaches it. The band
+// filters have unity peak gain, so the carrier's peak bounds what a band
+// passes of the chunk, and the band's carrier follower what is still ringing
+// in it; either a quiet modulator or a quiet carrier lets it rest. Its
+// carrier filters restart from zero, so the band fades back in with its
+// envelope's attack instead of replaying a stale state.
+bool OvocoderAudioProcessor::updateBandActivity(int channel, int band, const float* envelopeData, float carrierLevel, int numSamples, float threshold) {
+    bool& suspended = arena->getSuspended(channel)[band];
+    int& quietSamples = arena->getQuietSamples(channel)[band];
+    if (juce::FloatVectorOperations::findMaximum(envelopeData, numSamples) * carrierLevel >= threshold) {
+        suspended = false;
+        quietSamples = 0;
+        return true;
+    }
+
+    quietSamples += numSamples;
+    if (! suspended && quietSamples >= bandHoldSamples) {
+        suspended = true;
+        std::fill_n(arena->getStages(channel, DspStateArena::mainBank, band), arena->getLayout().order, VocoderDsp::StageState());
+    }
+    return ! suspended;
+}
+
+bool OvocoderAudioProcessor::isSilent(const juce::AudioBuffer<float>& bus, float threshold) {
+    for (int channel = 0; channel < bus.getNumChannels(); channel++) {
+        auto range = juce::FloatVectorOperations::findMinAndMax(bus.getReadPointer(channel), bus.getNumSamples());
+        if (range.getStart() < -threshold || range.getEnd() > threshold)
+            return false;
+    }
+    return true;
+}
+
+// The filter states have decayed below the threshold; clearing them makes the
+// wake-up start from exactly the state a fresh engine would have.
+void OvocoderAudioProcessor::enterSleep() {
+    sleeping = true;
+    resetBandFilters();
+    for (int channel = 0; channel < numChannels; channel++) {
+        meteringFrame.correlation[channel] = 0.0f;
+        meteringFrame.activeBands[channel] = 0;
+    }
+}
+
+// With silent input each follower just releases, so its state after
+// numSamples is known in closed form and the meters keep falling smoothly.
+void OvocoderAudioProcessor::sleepBlock(juce::AudioBuffer<float>& mainBuffer, int numSamples) {
+    const float release = std::pow(releaseCoeff.load(), (float) numSamples);
+    const int arenaBands = arena->getLayout().numBands;
+    for (int follower = 0; follower < DspStateArena::numFollowers; follower++)
+        for (int channel = 0; channel < numChannels; channel++)
+            juce::FloatVectorOperations::multiply(arena->getEnvelopes((DspStateArena::Follower) follower, channel), release, arenaBands);
+
+    // Only the (sub-threshold) dry signal is left to pass through; the gain
+    // ramps jump ahead by the block.
+    updateGainTargets();
+    wetGainSmoothed.skip(numSamples);
+    const float dryGain = dryGainSmoothed.skip(numSamples);
+    for (int channel = 0; channel < mainBuffer.getNumChannels(); channel++)
+        juce::FloatVectorOperations::multiply(mainBuffer.getWritePointer(channel), dryGain, numSamples);
+}
+
+// One set of band coefficients per svfUpdateInterval segment, from the
+// smoothed range and Q at the end of that segment. The centres are spaced as
+// in getBandCenterFrequency, by repeated multiplication instead of a pow per
+// band.
+void OvocoderAudioProcessor::updateSvfCoefficients(int numSamples) {
+    const int nb = blockNumBands;
+    minFreqSmoothed.setTargetValue(minCenterFreq.load());
+    maxFreqSmoothed.setTargetValue(maxCenterFreq.load());
+    qSmoothed.setTargetValue(qualityFactor.load());
+
+    const float depth = sweepDepth.load();
+    const float follow = sweepFollow.load();
+    const double phaseIncrement = sweepRate.load() / sampleRate;
+    const int numSegments = (numSamples + VocoderDsp::svfUpdateInterval - 1) / VocoderDsp::svfUpdateInterval;
+    const float startLevel = sweepLevel;
+    sweepLevel = follow != 0.0f ? getSweepLevel() : 0.0f;
+
+    for (int start = 0, segment = 0; start < numSamples; start += VocoderDsp::svfUpdateInterval, segment++) {
+        const int segmentSamples = juce::jmin(VocoderDsp::svfUpdateInterval, numSamples - start);
+        const float minF = minFreqSmoothed.skip(segmentSamples);
+        const float maxF = maxFreqSmoothed.skip(segmentSamples);
+        const float Q = qSmoothed.skip(segmentSamples);
+        const float ratio = nb > 1 ? std::pow(maxF / minF, 1.0f / (float) (nb - 1)) : 1.0f;
+        auto* analysisBands = arena->getSvfCoefficients(DspStateArena::sidechainBank, segment);
+        float centerFreq = minF;
+        for (int band = 0; band < nb; band++) {
+            analysisBands[band] = VocoderDsp::makeSvfBandPass((float) sampleRate, centerFreq, Q);
+            centerFreq *= ratio;
+        }
+
+        // Without a sweep the carrier bands are the analysis bands.
+        const float level = startLevel + (sweepLevel - startLevel) * (float) (segment + 1) / (float) numSegments;
+        const float sweep = depth * (float) std::sin(juce::MathConstants<double>::twoPi * sweepPhase) + follow * level;
+        sweepPhase += phaseIncrement * segmentSamples;
+        sweepPhase -= std::floor(sweepPhase);
+
+        auto* carrierBands = arena->getSvfCoefficients(DspStateArena::mainBank, segment);
+        if (sweep == 0.0f) {
+            std::copy(analysisBands, analysisBands + nb, carrierBands);
+        } else {
+            centerFreq = minF * std::exp2(sweep / 12.0f);
+            for (int band = 0; band < nb; band++) {
+                carrierBands[band] = VocoderDsp::makeSvfBandPass((float) sampleRate, centerFreq, Q);
+                centerFreq *= ratio;
             }
+        }
+    }
+}
+
+// The loudest sidechain envelope of either channel, from sweepFloorDb up to
+// 0 dB mapped onto 0 to 1.
+float OvocoderAudioProcessor::getSweepLevel() {
+    float peak = 0.0f;
+    for (int channel = 0; channel < numChannels; channel++)
+        peak = juce::jmax(peak, juce::FloatVectorOperations::findMaximum(arena->getEnvelopes(DspStateArena::sidechainFollower, channel), blockNumBands));
+    return juce::jlimit(0.0f, 1.0f, 1.0f - juce::Decibels::gainToDecibels(peak, sweepFloorDb) / sweepFloorDb);
+}
+
+void OvocoderAudioProcessor::updateMorphGains() {
+    const float amount = morphAmount.load();
+    morphGainsActive = false;
+    if (amount <= 0.0f)
+        return;
+
+    const auto& target = presetBank.getValues(juce::jlimit(0, presetBank.getNumPresets() - 1, morphTarget.load()));
+    const float low = juce::jmin(target[PresetBank::minFreq], target[PresetBank::maxFreq]);
+    const float high = juce::jmax(target[PresetBank::minFreq], target[PresetBank::maxFreq]);
+    const float minF = minCenterFreq.load(), maxF = maxCenterFreq.load();
+    const int nb = blockNumBands;
+    for (int band = 0; band < nb; band++) {
+        const float centerFreq = VocoderDsp::getBandCenterFrequency(band, nb, minF, maxF);
+        const bool covered = centerFreq >= low && centerFreq <= high;
+        morphBandGains[(size_t) band] = covered ? 1.0f : 1.0f - amount;
+        morphGainsActive = morphGainsActive || ! covered;
+    }
+}
 
-            mainChannelData[sample] = (std::sin(currentMix * juce::MathConstants<float>::halfPi) * sumMainSample * currentProcessedGain + (std::cos(currentMix * juce::MathConstants<float>::halfPi)) * mainChannelData[sample]) * currentGain;
+// Without shift or warp the analysis envelopes drive the carrier bands
+// directly and the remap is skipped.
+void OvocoderAudioProcessor::updateFormantRemap(int numSamples) {
+    formantShiftSmoothed.setTargetValue(formantShift.load());
+    formantWarpSmoothed.setTargetValue(formantWarp.load());
+    const float shift = formantShiftSmoothed.skip(numSamples);
+    const float warp = formantWarpSmoothed.skip(numSamples);
+
+    formantRemapActive = shift != 0.0f || warp != 1.0f;
+    if (! formantRemapActive)
+        return;
+
+    const int nb = blockNumBands;
+    // Signed: with min_freq above max_freq the bands run downwards.
+    const float octaves = std::log2(maxCenterFreq.load() / minCenterFreq.load());
+    const float bandsPerSemitone = nb > 1 && std::abs(octaves) > 0.01f ? (float) (nb - 1) / (12.0f * octaves) : 0.0f;
+    formantRemap.update(nb, shift * bandsPerSemitone, warp);
+}
+
+// The equal-power targets cost one sin/cos pair per sub-block; in between,
+// the gains move linearly towards them over gainSmoothingSeconds.
+void OvocoderAudioProcessor::updateGainTargets() {
+    const float currentGain = gain.load();
+    const float mixAngle = mix.load() * juce::MathConstants<float>::halfPi;
+    wetGainSmoothed.setTargetValue(std::sin(mixAngle) * processed_gain.load() * currentGain);
+    dryGainSmoothed.setTargetValue(std::cos(mixAngle) * currentGain);
+}
+
+void OvocoderAudioProcessor::fillGainRamps(int numSamples) {
+    fillRamp(wetGainSmoothed, gainRamps.getWritePointer(0), numSamples);
+    fillRamp(dryGainSmoothed, gainRamps.getWritePointer(1), numSamples);
+}
+
+void OvocoderAudioProcessor::fillRamp(juce::SmoothedValue<float>& smoothed, float* dest, int numSamples) {
+    const float start = smoothed.getCurrentValue();
+    const float target = smoothed.getTargetValue();
+    if (! smoothed.isSmoothing() || numSamples <= 0) {
+        juce::FloatVectorOperations::fill(dest, start, numSamples);
+        return;
+    }
+
+    // The step is constant until the ramp reaches the target, which may be
+    // part way through; skip() advances a linear ramp in constant time.
+    const float step = smoothed.getNextValue() - start;
+    smoothed.skip(numSamples - 1);
+    const int rampSamples = step != 0.0f ? juce::jlimit(0, numSamples, juce::roundToInt((target - start) / step)) : 0;
+    juce::FloatVectorOperations::copyWithMultiply(dest, rampSteps.getReadPointer(0), step, rampSamples);
+    juce::FloatVectorOperations::add(dest, start, rampSamples);
+    juce::FloatVectorOperations::fill(dest + rampSamples, target, numSamples - rampSamples);
+}
+
+void OvocoderAudioProcessor::filterBandGroup(DspStateArena::Bank bank, int channel, const int* bands, int numGroupBands, int order, const float* input, float* const* outputs, int numSamples) {
+    VocoderDsp::StageState* stages[VocoderDsp::bandGroupSize];
+    for (int i = 0; i < numGroupBands; i++)
+        stages[i] = arena->getStages(channel, bank, bands[i]);
+
+    if (svfActive) {
+        const VocoderDsp::SvfCoefficients* coefficients[VocoderDsp::bandGroupSize];
+        for (int i = 0; i < numGroupBands; i++)
+            coefficients[i] = arena->getSvfCoefficients(bank, 0) + bands[i];
+        VocoderDsp::processSvfBands(stages, coefficients, arena->getLayout().numBands, numGroupBands, order, input, outputs, numSamples);
+    } else {
+        const float* coefficients[VocoderDsp::bandGroupSize];
+        for (int i = 0; i < numGroupBands; i++)
+            coefficients[i] = coefficientTable->getBand(bands[i]);
+        VocoderDsp::processBiquadBands(stages, coefficients, numGroupBands, order, input, outputs, numSamples);
+    }
+}
+
+void OvocoderAudioProcessor::processChunk(const float* sidechainData, float* mainData, const float* unvoicedData, const float* wetGains, const float* dryGains, int channel, int numSamples, juce::int64 position) {
+    const int currentNumBands = blockNumBands;
+    const int currentOrder = blockOrder;
+    float* envelopeStates = arena->getEnvelopes(DspStateArena::sidechainFollower, channel);
+    float* mainInputEnvelopeStates = arena->getEnvelopes(DspStateArena::mainInputFollower, channel);
+    float* outputEnvelopeStates = arena->getEnvelopes(DspStateArena::outputFollower, channel);
+    const float currentAttackCoeff = attackCoeff.load();
+    const float currentReleaseCoeff = releaseCoeff.load();
+    const bool  currentCorrelationEnabled = correlationEnabled.load();
+
+    float* carrierData = processBuffer.getWritePointer(0);
+    float* correlationData = processBuffer.getWritePointer(1);
+    float* outputData = outputBuffer.getWritePointer(0);
+
+    auto stageMark = stageProfiler.mark();
+    traceRecorder.begin("correlation");
+
+    // Voiced/unvoiced detection, then the carrier as the correlation-weighted
+    // blend of the main and unvoiced inputs.
+    // An analysis that does not cover this channel or band count (e.g. after
+    // an automated band change) falls back to live analysis.
+    const bool analysisUsable = modulatorAnalysis != nullptr
+                             && channel < modulatorAnalysis->getNumChannels()
+                             && currentNumBands == modulatorAnalysis->getKey().numBands;
+    const bool replaying = analysisUsable && analysisMode == AnalysisMode::replay;
+
+    if (replaying) {
+        modulatorAnalysis->readCorrelation(channel, position, correlationData, numSamples);
+        if (currentCorrelationEnabled)
+            meteringFrame.correlation[channel] = correlationData[numSamples - 1];
+    } else {
+        correlationTrackers[channel].process(sidechainData, correlationData, numSamples, currentCorrelationEnabled);
+        if (currentCorrelationEnabled)
+            meteringFrame.correlation[channel] = correlationTrackers[channel].getCorrelation();
+    }
+
+    for (int sample = 0; sample < numSamples; sample++) {
+        float voicedGain = 1.0f, unvoicedGain = 0.0f;
+        if (currentCorrelationEnabled && unvoicedData != nullptr) {
+            float angle = correlationData[sample] * juce::MathConstants<float>::halfPi;
+            voicedGain = std::sin(angle);
+            unvoicedGain = std::cos(angle);
         }
+        carrierData[sample] = mainData[sample] * voicedGain + (unvoicedData != nullptr ? unvoicedData[sample] * unvoicedGain : 0.0f);
+    }
 
+    stageProfiler.addSince(StageProfiler::correlation, stageMark);
+    traceRecorder.end("correlation");
+
+    // Analysis: sidechain band envelopes.
+    traceRecorder.begin("analysis");
+    if (replaying) {
         for (int band = 0; band < currentNumBands; band++) {
-            envelopeValues[channel][band].store(envelopeStates[channel][band]);
-            mainInputEnvelopeValues[channel][band].store(mainInputEnvelopeStates[channel][band]);
-            outputEnvelopeValues[channel][band].store(outputEnvelopeStates[channel][band]);
+            float* envelopeData = envelopeBuffer.getWritePointer(band);
+            modulatorAnalysis->readEnvelopes(channel, band, position, envelopeData, numSamples);
+            envelopeStates[band] = envelopeData[numSamples - 1];
+        }
+        stageProfiler.addSince(StageProfiler::envelopes, stageMark);
+    } else {
+        for (int groupStart = 0; groupStart < currentNumBands; groupStart += VocoderDsp::bandGroupSize) {
+            const int groupBands = juce::jmin(VocoderDsp::bandGroupSize, currentNumBands - groupStart);
+            int bands[VocoderDsp::bandGroupSize];
+            float* envelopes[VocoderDsp::bandGroupSize];
+            for (int i = 0; i < groupBands; i++) {
+                bands[i] = groupStart + i;
+                envelopes[i] = envelopeBuffer.getWritePointer(groupStart + i);
+            }
+            filterBandGroup(DspStateArena::sidechainBank, channel, bands, groupBands, currentOrder, sidechainData, envelopes, numSamples);
+            stageProfiler.addSince(StageProfiler::filterbank, stageMark);
+            VocoderDsp::followEnvelopes(envelopeStates + groupStart, envelopes, envelopes, groupBands, numSamples, currentAttackCoeff, currentReleaseCoeff);
+            stageProfiler.addSince(StageProfiler::envelopes, stageMark);
         }
     }
 
+    if (analysisUsable && analysisMode == AnalysisMode::record) {
+        for (int band = 0; band < currentNumBands; band++)
+            modulatorAnalysis->writeEnvelopes(channel, band, position, envelopeBuffer.getReadPointer(band), numSamples);
+        modulatorAnalysis->writeCorrelation(channel, position, correlationData, numSamples);
+    }
+
+    traceRecorder.end("analysis");
+
+    // Synthesis: carrier bands scaled by the sidechain envelopes and summed.
+    // Bands whose output has stayed inaudible are suspended; their meters
+    // release as they would with silent input. The active bands are packed
+    // into groups of VocoderDsp::bandGroupSize for the group kernels, so a
+    // suspended band costs nothing even between active ones.
+    traceRecorder.begin("synthesis");
+    juce::FloatVectorOperations::clear(outputData, numSamples);
+    const float suspendedRelease = std::pow(currentReleaseCoeff, (float) numSamples);
+    const bool skipInactiveBands = bandSkippingEnabled.load();
+    // A band's share of the output is bounded by its envelope times its
+    // carrier level times the largest wet gain in the chunk. With no wet
+    // signal at all, every band can rest.
+    const float wetPeak = skipInactiveBands ? juce::FloatVectorOperations::findMaximum(wetGains, numSamples) : 0.0f;
+    const float activityThreshold = wetPeak > 0.0f ? bandActivityThreshold / wetPeak : std::numeric_limits<float>::infinity();
+    const auto carrierRange = skipInactiveBands ? juce::FloatVectorOperations::findMinAndMax(carrierData, numSamples) : juce::Range<float>();
+    const float carrierPeak = juce::jmax(-carrierRange.getStart(), carrierRange.getEnd());
+    int activeBands = 0;
+    // A band count change since the remap was built falls back to the
+    // unmapped envelopes until the next sub-block.
+    const bool remapping = formantRemapActive && formantRemap.getNumBands() == currentNumBands;
+
+    int groupBands[VocoderDsp::bandGroupSize];
+    const float* groupEnvelopes[VocoderDsp::bandGroupSize];
+    float* bands[VocoderDsp::bandGroupSize];
+    for (int i = 0; i < VocoderDsp::bandGroupSize; i++)
+        bands[i] = bandBuffer.getWritePointer(i);
+    int numGroupBands = 0;
+
+    auto synthesiseGroup = [&] {
+        float mainInputStates[VocoderDsp::bandGroupSize], outputStates[VocoderDsp::bandGroupSize];
+        for (int i = 0; i < numGroupBands; i++) {
+            mainInputStates[i] = mainInputEnvelopeStates[groupBands[i]];
+            outputStates[i] = outputEnvelopeStates[groupBands[i]];
+        }
+
+        filterBandGroup(DspStateArena::mainBank, channel, groupBands, numGroupBands, currentOrder, carrierData, bands, numSamples);
+        stageProfiler.addSince(StageProfiler::filterbank, stageMark);
+        VocoderDsp::followEnvelopes(mainInputStates, bands, nullptr, numGroupBands, numSamples, currentAttackCoeff, currentReleaseCoeff);
+        stageProfiler.addSince(StageProfiler::envelopes, stageMark);
+
+        for (int i = 0; i < numGroupBands; i++) {
+            juce::FloatVectorOperations::multiply(bands[i], groupEnvelopes[i], numSamples);
+            if (morphGainsActive)
+                juce::FloatVectorOperations::multiply(bands[i], morphBandGains[(size_t) groupBands[i]], numSamples);
+        }
+        stageProfiler.addSince(StageProfiler::mix, stageMark);
+        VocoderDsp::followEnvelopes(outputStates, bands, nullptr, numGroupBands, numSamples, currentAttackCoeff, currentReleaseCoeff);
+        stageProfiler.addSince(StageProfiler::envelopes, stageMark);
+
+        for (int i = 0; i < numGroupBands; i++) {
+            juce::FloatVectorOperations::add(outputData, bands[i], numSamples);
+            mainInputEnvelopeStates[groupBands[i]] = mainInputStates[i];
+            outputEnvelopeStates[groupBands[i]] = outputStates[i];
+        }
+        stageProfiler.addSince(StageProfiler::mix, stageMark);
+
+        activeBands += numGroupBands;
+        numGroupBands = 0;
+    };
+
+    for (int band = 0; band < currentNumBands; band++) {
+        // A remapped envelope goes to the slot the band takes in the group;
+        // a suspended band leaves it to the next one.
+        const float* bandEnvelope = envelopeBuffer.getReadPointer(band);
+        if (remapping) {
+            formantRemap.applyRow(band, envelopeBuffer, remappedEnvelope.getWritePointer(numGroupBands), numSamples);
+            bandEnvelope = remappedEnvelope.getReadPointer(numGroupBands);
+        }
+
+        const float carrierLevel = juce::jmax(carrierPeak, mainInputEnvelopeStates[band]);
+        if (skipInactiveBands && ! updateBandActivity(channel, band, bandEnvelope, carrierLevel, numSamples, activityThreshold)) {
+            mainInputEnvelopeStates[band] *= suspendedRelease;
+            outputEnvelopeStates[band] *= suspendedRelease;
+            continue;
+        }
+
+        groupBands[numGroupBands] = band;
+        groupEnvelopes[numGroupBands] = bandEnvelope;
+        if (++numGroupBands == VocoderDsp::bandGroupSize)
+            synthesiseGroup();
+    }
+    if (numGroupBands > 0)
+        synthesiseGroup();
+
+    meteringFrame.activeBands[channel] = activeBands;
+    traceRecorder.end("synthesis");
+
+    traceRecorder.begin("mix");
+    juce::FloatVectorOperations::multiply(mainData, dryGains, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(mainData, outputData, wetGains, numSamples);
+
+    stageProfiler.addSince(StageProfiler::mix, stageMark);
+    traceRecorder.end("mix");
+}
+
+// Host-side bypass goes through the same fade as the bypass parameter.
+void OvocoderAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processingBypassed = true;
+    processBlock(buffer, midiMessages);
+    processingBypassed = false;
+}
+
+juce::AudioProcessorParameter* OvocoderAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter("bypass");
 }
 
 //==============================================================================
@@ -554,20 +1473,85 @@ juce::AudioProcessorEditor* OvocoderAudioProcessor::createEditor()
 }
 
 //==============================================================================
+// The XML state earlier versions write and read comes first, so sessions
+// saved with this version still open in them. After it: "OVST", version,
+// current program, the plain value of every parameter by ID, so that added,
+// removed or reordered parameters still load, and last the size of that
+// binary block, so it can be found from the end of the data.
 void OvocoderAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto state = apvts.copyState();
-    std::unique_ptr<juce::XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    destData.reset();
+    if (auto xml = apvts.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
+
+    juce::MemoryOutputStream stream (destData, true);
+    const auto binaryStart = stream.getPosition();
+    stream.write("OVST", 4);
+    stream.writeInt(stateVersion);
+    stream.writeInt(currentProgram.load());
+
+    const auto& parameters = getParameters();
+    stream.writeCompressedInt(parameters.size());
+    for (auto* parameter : parameters) {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        stream.writeString(ranged->paramID);
+        stream.writeFloat(ranged->convertFrom0to1(ranged->getValue()));
+    }
+    stream.writeInt((int) (stream.getPosition() - binaryStart));
 }
 
 void OvocoderAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+    restoringState.store(true);
+
+    if (! readBinaryState(data, sizeInBytes)) {
+        std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+
+        if (xmlState.get() != nullptr)
+            if (xmlState->hasTagName (apvts.state.getType()))
+                apvts.replaceState (juce::ValueTree::fromXml (*xmlState));
+    }
+
+    restoringState.store(false);
+    applyAllParameters();
+}
+
+// Parameters missing from the state go back to their defaults, as they do
+// with the XML. Returns false if the data holds no binary state.
+bool OvocoderAudioProcessor::readBinaryState(const void* data, int sizeInBytes) {
+    if (sizeInBytes < 16)
+        return false;
 
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName (apvts.state.getType()))
-            apvts.replaceState (juce::ValueTree::fromXml (*xmlState));
+    const auto* bytes = static_cast<const char*> (data);
+    const int binarySize = (int) juce::ByteOrder::littleEndianInt(bytes + sizeInBytes - 4);
+    if (binarySize < 12 || binarySize > sizeInBytes - 4
+        || std::memcmp(bytes + sizeInBytes - 4 - binarySize, "OVST", 4) != 0)
+        return false;
+
+    juce::MemoryInputStream stream (bytes + sizeInBytes - 4 - binarySize, (size_t) binarySize, false);
+    stream.skipNextBytes(4);
+    if (stream.readInt() > stateVersion)
+        return false;
+    const int program = stream.readInt();
+
+    juce::NamedValueSet values;
+    const int numValues = stream.readCompressedInt();
+    for (int i = 0; i < numValues && ! stream.isExhausted(); i++) {
+        const auto parameterID = stream.readString();
+        const float value = stream.readFloat();
+        if (parameterID.isNotEmpty())
+            values.set(parameterID, value);
+    }
+
+    for (auto* parameter : getParameters()) {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        const float defaultValue = ranged->convertFrom0to1(ranged->getDefaultValue());
+        ranged->setValueNotifyingHost(ranged->convertTo0to1(values.getWithDefault(ranged->paramID, defaultValue)));
+    }
+
+    if (juce::isPositiveAndBelow(program, getNumPrograms()))
+        currentProgram.store(program);
+    return true;
 }
 
 //==============================================================================
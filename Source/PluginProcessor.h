@@ -9,10 +9,24 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-#define MAX_ORDER 8
-#define AUTOCORRELATION_DOWNSAMPLE 8
-#define MAX_BANDS 64
+#include "CorrelationTracker.h"
+#include "StageProfiler.h"
+#include "TraceRecorder.h"
+#include "EnvelopeCapture.h"
+#include "ModulatorAnalysis.h"
+#include "MetricsPublisher.h"
+#include "SeqLock.h"
+#include "FrameRing.h"
+#include "VocoderDsp.h"
+#include "FormantRemap.h"
+#include "CoefficientCache.h"
+#include "PresetBank.h"
+#include "DspStateArena.h"
+
+// Ceilings of the per-instance Limits; the metering frames and the formant
+// remap are sized for them, everything else for the limits in effect.
+#define MAX_ORDER 16
+#define MAX_BANDS 256
 //==============================================================================
 /**
 */
@@ -20,18 +34,33 @@ class OvocoderAudioProcessor  : public juce::AudioProcessor, public juce::AudioP
 {
 public:
     //==============================================================================
-    OvocoderAudioProcessor();
+    // Ranges of the num_bands and order parameters, fixed for the lifetime of
+    // an instance. The defaults keep the ranges (and so the automation
+    // mapping) of earlier versions; OVOCODER_MAX_BANDS and OVOCODER_MAX_ORDER
+    // raise them up to MAX_BANDS and MAX_ORDER.
+    struct Limits
+    {
+        int maxBands = 64;
+        int maxOrder = 8;
+
+        static Limits fromEnvironment();
+    };
+
+    explicit OvocoderAudioProcessor(Limits limits = Limits::fromEnvironment());
     ~OvocoderAudioProcessor() override;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    juce::AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -57,37 +86,271 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     //==============================================================================
-    float getEnvelopeValue(int channel, int band) const { return envelopeValues[channel][band].load(); }
-    float getCorrelationValue(int channel) const {return correlationValues[channel].load();}
-    float getMainInputEnvelopeValue(int channel, int band) const { return mainInputEnvelopeValues[channel][band].load(); }
-    float getOutputEnvelopeValue(int channel, int band) const { return outputEnvelopeValues[channel][band].load(); }
+    // Everything the editor meters, published as one frame per block. Frames
+    // hold getLimits().maxBands envelopes per follower and channel.
+    struct MeteringFrame
+    {
+        explicit MeteringFrame(int _maxBands)
+            : maxBands(_maxBands), envelopes((size_t) (DspStateArena::numFollowers * 2 * _maxBands)) {}
+
+        float* getEnvelopes(DspStateArena::Follower follower, int channel) noexcept {
+            return envelopes.data() + (size_t) ((follower * 2 + channel) * maxBands);
+        }
+        const float* getEnvelopes(DspStateArena::Follower follower, int channel) const noexcept {
+            return envelopes.data() + (size_t) ((follower * 2 + channel) * maxBands);
+        }
+
+        int numBands = 0;
+        int activeBands[2] = {};
+        float correlation[2] = {};
+        int maxBands;
+        std::vector<float> envelopes;
+    };
+
+    // Copies the latest complete frame into one sized with getLimits();
+    // returns false, leaving frame's contents undefined, if the audio thread
+    // was publishing at that moment.
+    bool getMeteringFrame(MeteringFrame& frame) const;
+
+    // Sidechain band envelopes at the end of every block, queued for the
+    // editor's history view while it is enabled. Sized like MeteringFrame.
+    struct EnvelopeHistoryFrame
+    {
+        explicit EnvelopeHistoryFrame(int _maxBands)
+            : maxBands(_maxBands), envelopes((size_t) (2 * _maxBands)) {}
+
+        float* getEnvelopes(int channel) noexcept { return envelopes.data() + (size_t) (channel * maxBands); }
+        const float* getEnvelopes(int channel) const noexcept { return envelopes.data() + (size_t) (channel * maxBands); }
+
+        int numBands = 0;
+        int numSamples = 0;
+        int maxBands;
+        std::vector<float> envelopes;
+    };
+
+    // The history ring only exists while enabled; disabling waits for a
+    // block that is pushing to it before freeing it.
+    void setEnvelopeHistoryEnabled(bool shouldBeEnabled);
+    bool popEnvelopeHistory(EnvelopeHistoryFrame& frame) { return envelopeHistory.pop(frame); }
     int getNumBands() const { return numBands.load(); }
+    const Limits& getLimits() const { return limits; }
+    StageProfiler& getStageProfiler() { return stageProfiler; }
+    TraceRecorder& getTraceRecorder() { return traceRecorder; }
+    EnvelopeCapture& getEnvelopeCapture() { return envelopeCapture; }
+
+    // CPU savings that change the output only below audibility (silence
+    // sleep, band skipping); both on by default. The golden check turns them
+    // off for its bit-exact reference.
+    void setSilenceSleepEnabled(bool shouldBeEnabled) { silenceSleepEnabled.store(shouldBeEnabled); }
+    void setBandSkippingEnabled(bool shouldBeEnabled) { bandSkippingEnabled.store(shouldBeEnabled); }
+
+    // Band filters, the filter_engine parameter: the state variable filters
+    // are retuned every VocoderDsp::svfUpdateInterval samples from smoothed
+    // min_freq, max_freq and q, so those can be swept at audio rate, and
+    // follow the carrier sweep; the biquads switch to a new coefficient table
+    // whenever they change. The biquads are the default, so existing
+    // sessions keep their sound; the golden check records its reference with
+    // them too. Sets the parameter, so it is saved with the state.
+    void setSvfFiltersEnabled(bool shouldBeEnabled);
+
+    // Offline rendering against a cached modulator analysis. In record mode
+    // the sidechain is analysed as usual and the envelopes and correlation
+    // are also written to the analysis; in replay mode they are read from it
+    // and the sidechain input is ignored. Set between blocks from the
+    // rendering thread (the analysis must outlive its use); the position
+    // restarts at zero with every call and on reset().
+    enum class AnalysisMode { live, record, replay };
+    void setModulatorAnalysis(ModulatorAnalysis* analysis, AnalysisMode mode);
+
+    // The key an analysis must match for the current parameters.
+    ModulatorAnalysis::Key getAnalysisKey(int blockSize) const;
+
+    // Points the biquads at the coefficient table for the current bands/Q/
+    // frequency range, from the process-wide cache; only a layout no
+    // instance has used yet is built. Locks and may allocate: processBlock
+    // only calls it when rendering offline, and otherwise has the arena
+    // thread look the table up.
+    void updateFilterCoefficients();
 
     static constexpr int numChannels = 2;
     static constexpr int maxBands = MAX_BANDS;
+    static constexpr int maxOrder = MAX_ORDER;
+
+    static constexpr int mainBusIndex = 0;
+    static constexpr int unvoicedBusIndex = 1;
+    static constexpr int sidechainBusIndex = 2;
 
     juce::AudioProcessorValueTreeState apvts;
 
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OvocoderAudioProcessor)
-    float envelopeStates[2][MAX_BANDS] = {0.0f, 0.0f};
+    const Limits limits;
     std::atomic<float> attackCoeff{0.0f};
     std::atomic<float> releaseCoeff{0.0f};
-    float correlationAttackCoeff = 0.0f;
-    float correlationReleaseCoeff = 0.0f;
-    std::atomic<float> envelopeValues[2][MAX_BANDS] = {0.0f, 0.0f};
-
-    using Filter = juce::dsp::IIR::Filter<float>;
-    using Coefficients = juce::dsp::IIR::Coefficients<float>;
-
-    Filter sidechainFilters[numChannels][MAX_BANDS][MAX_ORDER];
-    Filter mainFilters[numChannels][MAX_BANDS][MAX_ORDER];
 
+    // Filter, envelope, band activity and correlation state, laid out for
+    // the current band count, order and filter engine. A layout change is
+    // built on the shared arena thread and swapped in at the start of a
+    // block through pendingArena; the replaced arena goes back through
+    // retiredArena to be freed there. The same thread looks up coefficient
+    // tables. Until the new arena arrives, bands and
+    // stages it does not cover are left out (blockNumBands, blockOrder).
+    // Offline rendering builds the new arena in place instead.
+    std::unique_ptr<DspStateArena> arena;
+    std::atomic<DspStateArena*> pendingArena{nullptr};
+    std::atomic<DspStateArena*> retiredArena{nullptr};
+    std::atomic<bool> arenaRequested{false};
+    int correlationStorageSize = 0;
+    int blockNumBands = 0;
+    int blockOrder = 0;
+    DspStateArena::Layout getWantedArenaLayout() const;
+    DspStateArena* swapInArena(DspStateArena* fresh);
+    void updateArena();
+    void updateBlockConfiguration();
+    void releaseArenas();
+    int serviceArena();
+
+    struct ArenaThread : public juce::TimeSliceThread
+    {
+        ArenaThread() : juce::TimeSliceThread("Ovocoder arena builder") { startThread(); }
+        ~ArenaThread() override { stopThread(1000); }
+    };
+
+    struct ArenaBuilder : public juce::TimeSliceClient
+    {
+        explicit ArenaBuilder(OvocoderAudioProcessor& p) : processor(p) {}
+        int useTimeSlice() override { return processor.serviceArena(); }
+        OvocoderAudioProcessor& processor;
+    };
+
+    juce::SharedResourcePointer<ArenaThread> arenaThread;
+    ArenaBuilder arenaBuilder { *this };
+
+    // Scratch for one chunk of one channel: processBuffer holds the carrier
+    // input and the correlation trace, envelopeBuffer the per-band sidechain
+    // envelopes, bandBuffer the group of bands being synthesised (one channel
+    // per band), outputBuffer the sum.
     juce::AudioBuffer<float> processBuffer;
+    juce::AudioBuffer<float> envelopeBuffer;
+    juce::AudioBuffer<float> bandBuffer;
     juce::AudioBuffer<float> outputBuffer;
-
-    juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    int maxChunkSize = 0;
+
+    // Host blocks are processed in sub-blocks of at most this many samples
+    // (a multiple of AUTOCORRELATION_DOWNSAMPLE). Parameter changes are picked
+    // up at every sub-block boundary, so automation resolution no longer
+    // depends on the host buffer size. It is not sample accurate: the plugin
+    // wrappers hand over parameter values without the host's sample offsets,
+    // so a change lands on the next boundary, up to 64 samples (1.3 ms at
+    // 48 kHz) late. That is an accepted limit; the gain and frequency
+    // smoothing hides the steps.
+    static constexpr int automationSubBlockSize = 64;
+
+    // Output gains, smoothed towards the values implied by gain, proc_gain
+    // and mix; gainRamps holds the per-sample wet (0) and dry (1) gains of
+    // the current sub-block, shared by both channels.
+    static constexpr double gainSmoothingSeconds = 0.02;
+    juce::SmoothedValue<float> wetGainSmoothed;
+    juce::SmoothedValue<float> dryGainSmoothed;
+    juce::AudioBuffer<float> gainRamps;
+    void updateGainTargets();
+    void fillGainRamps(int numSamples);
+
+    // 1, 2, 3, ... up to the prepared block size. fillRamp writes the next
+    // values of a linear SmoothedValue with vector operations and advances it.
+    juce::AudioBuffer<float> rampSteps;
+    void fillRamp(juce::SmoothedValue<float>& smoothed, float* dest, int numSamples);
+
+    // State variable filterbank. The arena holds the band coefficients of
+    // every update segment in the current sub-block, shared by both channels.
+    static constexpr double frequencySmoothingSeconds = 0.05;
+    static constexpr int maxSvfSegments = automationSubBlockSize / VocoderDsp::svfUpdateInterval;
+    std::atomic<bool> svfFiltersEnabled{false};
+    bool svfActive = false;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> minFreqSmoothed;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> maxFreqSmoothed;
+    juce::SmoothedValue<float> qSmoothed;
+    void updateSvfCoefficients(int numSamples);
+
+    // Carrier sweep, in semitones: an LFO (sweep_rate, sweep_depth) and the
+    // modulator level (sweep_follow, full depth at 0 dB, none at -60 dB)
+    // move the carrier bands of the state variable filters every update
+    // segment, while the analysis bands stay put. The level is the loudest
+    // sidechain envelope at the start of the sub-block, ramped across its
+    // segments; being the analysis output, it is there when replaying too.
+    static constexpr float sweepFloorDb = -60.0f;
+    std::atomic<float> sweepRate{0.5f};
+    std::atomic<float> sweepDepth{0.0f};
+    std::atomic<float> sweepFollow{0.0f};
+    double sweepPhase = 0.0;
+    float sweepLevel = 0.0f;
+    float getSweepLevel();
+
+    // Formant shift (semitones) and warp (band spread), applied by remapping
+    // the analysis envelopes onto the carrier bands once per sub-block;
+    // remappedEnvelope holds the carrier bands of the group being
+    // synthesised.
+    static constexpr double formantSmoothingSeconds = 0.05;
+    std::atomic<float> formantShift{0.0f};
+    std::atomic<float> formantWarp{1.0f};
+    juce::SmoothedValue<float> formantShiftSmoothed;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> formantWarpSmoothed;
+    FormantRemap<MAX_BANDS> formantRemap;
+    bool formantRemapActive = false;
+    juce::AudioBuffer<float> remappedEnvelope;
+    void updateFormantRemap(int numSamples);
+
+    // Biquad coefficients. coefficientTable holds one reference, owned by
+    // whichever thread processes blocks. When filtersDirty is set, the block
+    // raises tableRequested and the arena thread looks the table up and
+    // hands it over through pendingTable; the one it replaces goes back
+    // through retiredTable to be released there, so the audio thread never
+    // builds or frees a table. The state variable filters use no table.
+    CoefficientTable* coefficientTable = nullptr;
+    std::atomic<CoefficientTable*> pendingTable{nullptr};
+    std::atomic<CoefficientTable*> retiredTable{nullptr};
+    std::atomic<bool> tableRequested{false};
+    CoefficientTable::Key getWantedTableKey() const;
+    void requestCoefficientTable();
+    bool takePendingTable();
+    bool swapInTable(CoefficientTable* fresh);
+    void releaseCoefficientTable();
+
+    // Programs and morphing. The morph blends the current parameter values
+    // towards the morph_target preset on the band layout of the current
+    // settings; program changes hand their precomputed layout to the audio
+    // thread through pendingPresetLayout.
+    PresetBank presetBank;
+    juce::SharedResourcePointer<CoefficientCache> coefficientCache;
+    std::atomic<int> currentProgram{0};
+    std::atomic<int> pendingPresetLayout{-1};
+    std::atomic<float> morphAmount{0.0f};
+    std::atomic<int> morphTarget{0};
+    std::atomic<float>* morphableValues[PresetBank::numMorphable] = {};
+    float getMorphedValue(PresetBank::Morphable parameter, float value) const noexcept;
+    void applyMorphableParameter(PresetBank::Morphable parameter, float newValue);
+    bool installPresetLayout(const PresetBank::Layout& layout);
+
+    // The target's frequency range on the shared layout: bands outside it
+    // fade out with the morph amount. Updated once per sub-block;
+    // morphGainsActive is false while every gain is 1.
+    std::array<float, MAX_BANDS> morphBandGains {};
+    bool morphGainsActive = false;
+    void updateMorphGains();
+
+    // State: a versioned binary format appended to the XML earlier versions
+    // use, which is still accepted on its own. While a state is restored,
+    // parameterChanged ignores the per-parameter callbacks;
+    // applyAllParameters() then applies everything at once, so the filters
+    // are rebuilt a single time.
+    static constexpr int stateVersion = 1;
+    std::atomic<bool> restoringState{false};
+    void applyAllParameters();
+    bool readBinaryState(const void* data, int sizeInBytes);
+    void resetBandFilters();
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout(const Limits& limits);
 
     void setAttackCoeff(float attackInMs);
     void setReleaseCoeff(float releaseInMs);
@@ -101,7 +364,45 @@ private:
     void setMaxFreq(float maxFreq);
     void setProcessedGain(float gainInDb);
 
-    void updateFilterCoefficients();
+    // Band activity: carrier bands are not synthesised while what they would
+    // add to the output, their sidechain envelope times the carrier level in
+    // the band times the wet gain, stays below -100 dB.
+    static constexpr float bandActivityThreshold = 1.0e-5f;
+    std::atomic<bool> bandSkippingEnabled{true};
+    static constexpr double bandHoldSeconds = 0.05;
+    int bandHoldSamples = 0;
+    bool updateBandActivity(int channel, int band, const float* envelopeData, float carrierLevel, int numSamples, float threshold);
+
+    // Bypass fade, 0 = processed, 1 = dry. The dry copy and the per-sample
+    // ramp are sized in prepareToPlay; longer host blocks fade in slices.
+    static constexpr double bypassFadeSeconds = 0.02;
+    static constexpr double bypassPrewarmSeconds = 0.05;
+    std::atomic<bool> bypassed{false};
+    bool processingBypassed = false;
+    bool fullyBypassed = false;
+    int bypassPrewarmSamples = 0;
+    int bypassPrewarmRemaining = 0;
+    juce::SmoothedValue<float> bypassFade;
+    juce::AudioBuffer<float> bypassDryBuffer;
+    juce::AudioBuffer<float> bypassRamp;
+
+    // The wet output is kept below silenceThreshold (-120 dBFS): inputs count
+    // as silent below it divided by the wet gain, when that exceeds unity.
+    static constexpr float silenceThreshold = 1.0e-6f;
+    float getInputSilenceThreshold() const;
+    std::atomic<bool> silenceSleepEnabled{true};
+    juce::int64 silentSamples = 0;
+    bool sleeping = false;
+
+    static bool isSilent(const juce::AudioBuffer<float>& bus, float threshold);
+    void enterSleep();
+    void sleepBlock(juce::AudioBuffer<float>& mainBuffer, int numSamples);
+
+    // Runs input through the numGroupBands bands listed in bands (at most
+    // VocoderDsp::bandGroupSize, in any order), with the active engine; see
+    // VocoderDsp::processBiquadBands.
+    void filterBandGroup(DspStateArena::Bank bank, int channel, const int* bands, int numGroupBands, int order, const float* input, float* const* outputs, int numSamples);
+    void processChunk(const float* sidechainData, float* mainData, const float* unvoicedData, const float* wetGains, const float* dryGains, int channel, int numSamples, juce::int64 position);
 
     int sampleRate = 48000;
 
@@ -118,34 +419,35 @@ private:
     std::atomic<float> processed_gain{1.0f};
 
     // Autocorrelation
-    float minFundamentalFreq = 60.0; 
-    float maxFundamentalFreq = 400.0;
-
-    juce::AudioBuffer<float> correlationBuffer;
-    int correlationBufferPointers[numChannels] = {0, 0};
-    float currentWindowEnergyLevels[numChannels] = {0.0f, 0.0f};
-    juce::AudioBuffer<float> correlationLevels;
-    juce::AudioBuffer<float> lagEnergyLevels;
-
-    int minLag, maxLag, correlationBufferSize;
-    std::atomic<float> correlationValues[2] = {0.0f, 0.0f};
-    float lastCorrelation[2] = {0.0f, 0.0f};
-
-    float correlationReleaseInMs = 5.0f;
-    float correlationAttackInMs = 5.0f;
-
-    Filter correlationDownsampleFilters[2];
+    CorrelationTracker correlationTrackers[numChannels];
 
     std::atomic<bool> correlationEnabled{false};
 
-    float mainInputEnvelopeStates[2][MAX_BANDS] = {0.0f, 0.0f};
-    std::atomic<float> mainInputEnvelopeValues[2][MAX_BANDS] = {0.0f, 0.0f};
-
-    float outputEnvelopeStates[2][MAX_BANDS] = {0.0f, 0.0f};
-    std::atomic<float> outputEnvelopeValues[2][MAX_BANDS] = {0.0f, 0.0f};
-
     std::atomic<float> mix{1.0f};
 
     std::atomic<int> numBands{8};
     std::atomic<bool> filtersDirty{false};
+
+    StageProfiler stageProfiler;
+    TraceRecorder traceRecorder;
+    EnvelopeCapture envelopeCapture { numChannels, limits.maxBands };
+    MetricsPublisher metricsPublisher;
+
+    ModulatorAnalysis* modulatorAnalysis = nullptr;
+    AnalysisMode analysisMode = AnalysisMode::live;
+    juce::int64 analysisPosition = 0;
+
+    // The snapshot is the five header words followed by one row of maxBands
+    // floats per follower and channel; only numBands of each row are copied.
+    MeteringFrame meteringFrame { limits.maxBands };
+    SeqLockBuffer meteringSnapshot { 5 + DspStateArena::numFollowers * 2 * limits.maxBands };
+    void publishMeteringFrame() noexcept;
+
+    // Holds the blocks between two editor ticks at its idle frame rate, even
+    // with 32-sample blocks at 96 kHz.
+    static constexpr int envelopeHistorySize = 1024;
+    std::atomic<bool> envelopeHistoryEnabled{false};
+    std::atomic<bool> pushingEnvelopeHistory{false};
+    EnvelopeHistoryFrame envelopeHistoryFrame { limits.maxBands };
+    FrameRing<EnvelopeHistoryFrame> envelopeHistory;
 };
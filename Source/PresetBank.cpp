@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+static PresetBank::Preset makePreset(const juce::String& name, std::initializer_list<std::pair<const char*, float>> values) {
+    PresetBank::Preset preset;
+    preset.name = name;
+    for (const auto& value : values)
+        preset.values.set(value.first, value.second);
+    return preset;
+}
+
+const std::vector<PresetBank::Preset>& PresetBank::getFactoryPresets() {
+    static const std::vector<Preset> presets {
+        makePreset("Default", {}),
+        makePreset("Classic 16", { { "num_bands", 16.0f }, { "min_freq", 100.0f }, { "max_freq", 8000.0f }, { "q", 4.0f },
+                                   { "attack", 2.0f }, { "release", 40.0f }, { "proc_gain", 12.0f } }),
+        makePreset("Robot", { { "num_bands", 8.0f }, { "min_freq", 200.0f }, { "max_freq", 5000.0f }, { "q", 8.0f }, { "order", 4.0f },
+                              { "attack", 1.0f }, { "release", 10.0f }, { "proc_gain", 18.0f } }),
+        makePreset("Intelligible 32", { { "num_bands", 32.0f }, { "min_freq", 80.0f }, { "max_freq", 12000.0f }, { "q", 6.0f },
+                                        { "attack", 3.0f }, { "release", 30.0f }, { "correlation_enabled", 1.0f }, { "proc_gain", 12.0f } }),
+        makePreset("Choir", { { "num_bands", 24.0f }, { "min_freq", 150.0f }, { "max_freq", 6000.0f }, { "q", 10.0f }, { "order", 3.0f },
+                              { "attack", 20.0f }, { "release", 200.0f }, { "mix", 0.9f }, { "proc_gain", 15.0f } }),
+        makePreset("Formant down", { { "num_bands", 16.0f }, { "min_freq", 100.0f }, { "max_freq", 8000.0f }, { "q", 4.0f },
+                                     { "formant_shift", -5.0f }, { "proc_gain", 12.0f } }),
+    };
+    return presets;
+}
+
+const char* const PresetBank::morphableParameterIDs[numMorphable] = {
+    "attack", "release", "q", "order", "gain", "correlation_enabled", "mix",
+    "num_bands", "min_freq", "max_freq", "proc_gain", "formant_shift", "formant_warp"
+};
+
+const PresetBank::Blend PresetBank::blends[numMorphable] = {
+    Blend::geometric, Blend::geometric, Blend::held, Blend::held, Blend::linear, Blend::step, Blend::linear,
+    Blend::held, Blend::held, Blend::held, Blend::linear, Blend::linear, Blend::geometric
+};
+
+juce::StringArray PresetBank::getFactoryPresetNames() {
+    juce::StringArray names;
+    for (const auto& preset : getFactoryPresets())
+        names.add(preset.name);
+    return names;
+}
+
+float PresetBank::interpolate(Morphable parameter, float from, float to, float amount) noexcept {
+    switch (blends[parameter]) {
+        case Blend::held:
+            return from;
+        case Blend::step:
+            return amount < 0.5f ? from : to;
+        case Blend::geometric:
+            return from * std::pow(to / from, amount);
+        case Blend::linear:
+            break;
+    }
+    return from + (to - from) * amount;
+}
+
+void PresetBank::resolve(juce::AudioProcessorValueTreeState& apvts) {
+    const auto& presets = getFactoryPresets();
+    values.resize(presets.size());
+
+    for (size_t i = 0; i < presets.size(); i++) {
+        for (int parameter = 0; parameter < numMorphable; parameter++) {
+            const auto* parameterID = morphableParameterIDs[parameter];
+            auto* ranged = apvts.getParameter(parameterID);
+            jassert(ranged != nullptr);
+            values[i][(size_t) parameter] = presets[i].values.getWithDefault(parameterID, ranged->convertFrom0to1(ranged->getDefaultValue()));
+        }
+    }
+}
+
+void PresetBank::prepare(double sampleRate, CoefficientCache* cache) {
+    jassert(values.size() == getFactoryPresets().size());
+    layouts.resize(values.size());
+
+    for (size_t i = 0; i < values.size(); i++) {
+        auto& layout = layouts[i];
+        layout.numBands = (int) values[i][numBands];
+        layout.minFreq = values[i][minFreq];
+        layout.maxFreq = values[i][maxFreq];
+        layout.q = values[i][q];
+        layout.table = cache != nullptr ? cache->get({ sampleRate, layout.numBands, layout.minFreq, layout.maxFreq, layout.q }) : nullptr;
+    }
+}
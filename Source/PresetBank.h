@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Factory presets, exposed to the host as programs and used as morph
+    targets. resolve() turns every preset into one plain value per morphable
+    parameter, so morphing on the audio thread is arithmetic on a table.
+    prepare() fetches every preset's coefficient table for the current
+    sample rate off the audio thread, so a program change installs shared
+    coefficients instead of rebuilding them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CoefficientCache.h"
+
+class PresetBank
+{
+public:
+    struct Preset
+    {
+        juce::String name;
+        // Plain parameter values by parameter ID; missing parameters keep
+        // their defaults.
+        juce::NamedValueSet values;
+    };
+
+    // Parameters that presets set and the morph blends.
+    enum Morphable
+    {
+        attack, release, q, order, gain, correlationEnabled, mix,
+        numBands, minFreq, maxFreq, procGain, formantShift, formantWarp,
+        numMorphable
+    };
+
+    static const char* const morphableParameterIDs[numMorphable];
+
+    using Values = std::array<float, numMorphable>;
+
+    struct Layout
+    {
+        int numBands = 0;
+        float minFreq = 0.0f, maxFreq = 0.0f, q = 0.0f;
+        CoefficientTable::Ptr table;
+    };
+
+    static const std::vector<Preset>& getFactoryPresets();
+    static juce::StringArray getFactoryPresetNames();
+
+    // Blend of a parameter's plain value towards a preset's: geometric for
+    // times and the formant warp, a switch at the midpoint for toggles,
+    // linear otherwise. The band layout (band count, order, Q and frequency
+    // range) is held: the morph runs on the layout of the current settings,
+    // so it never rebuilds filters. Real-time safe.
+    static float interpolate(Morphable parameter, float from, float to, float amount) noexcept;
+    static bool isMorphed(Morphable parameter) noexcept { return blends[parameter] != Blend::held; }
+
+    // Message thread, once the parameters exist; parameters a preset leaves
+    // out take their defaults. The values never move afterwards, so the
+    // audio thread may read them at any time.
+    void resolve(juce::AudioProcessorValueTreeState& apvts);
+    int getNumPresets() const noexcept { return (int) values.size(); }
+    const Values& getValues(int preset) const noexcept { return values[(size_t) preset]; }
+
+    // Message thread (prepareToPlay); may allocate. Call after resolve().
+    // Without a cache the layouts get no tables, for the state variable
+    // filters, which need none.
+    void prepare(double sampleRate, CoefficientCache* cache);
+    const Layout& getLayout(int preset) const { return layouts[(size_t) preset]; }
+
+private:
+    enum class Blend { held, step, geometric, linear };
+    static const Blend blends[numMorphable];
+
+    std::vector<Values> values;
+    std::vector<Layout> layouts;
+};
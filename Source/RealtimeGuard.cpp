@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <execinfo.h>
+ #include <pthread.h>
+#endif
+
+namespace RealtimeGuard
+{
+    static thread_local int sectionDepth = 0;
+    static thread_local bool reporting = false;
+    static thread_local int uncontendedLocksDepth = 0;
+
+    static Violation violations[maxViolations];
+    static std::atomic<int> numViolations { 0 };
+
+    ScopedSection::ScopedSection() noexcept { ++sectionDepth; }
+    ScopedSection::~ScopedSection() noexcept { --sectionDepth; }
+
+    bool isActive() noexcept {
+        return sectionDepth > 0 && ! reporting;
+    }
+
+    ScopedUncontendedLocksAllowed::ScopedUncontendedLocksAllowed() noexcept { ++uncontendedLocksDepth; }
+    ScopedUncontendedLocksAllowed::~ScopedUncontendedLocksAllowed() noexcept { --uncontendedLocksDepth; }
+
+    bool uncontendedLocksAllowed() noexcept {
+        return uncontendedLocksDepth > 0;
+    }
+
+    void reportViolation(const char* kind) noexcept {
+        if (reporting)
+            return;
+        reporting = true;
+
+        const int index = numViolations.fetch_add(1);
+        if (index < maxViolations) {
+            auto& violation = violations[index];
+            violation.kind = kind;
+           #if JUCE_LINUX || JUCE_MAC
+            violation.threadId = (juce::uint64) pthread_self();
+            violation.numFrames = backtrace(violation.frames, maxFrames);
+           #endif
+        }
+
+        reporting = false;
+    }
+
+    void initialise() {
+       #if JUCE_LINUX || JUCE_MAC
+        // backtrace() loads the unwinder on first use, which allocates.
+        void* frames[maxFrames];
+        backtrace(frames, maxFrames);
+       #endif
+    }
+
+    int getNumViolations() noexcept {
+        return numViolations.load();
+    }
+
+    std::vector<Violation> getViolations() {
+        const int count = juce::jmin(numViolations.load(), maxViolations);
+        return std::vector<Violation>(violations, violations + count);
+    }
+
+    void clearViolations() noexcept {
+        numViolations.store(0);
+    }
+
+    void printViolations(std::ostream& out) {
+        const auto recorded = getViolations();
+        for (size_t i = 0; i < recorded.size(); i++) {
+            const auto& violation = recorded[i];
+            out << "violation " << i << ": " << violation.kind << " on thread " << violation.threadId << std::endl;
+           #if JUCE_LINUX || JUCE_MAC
+            if (char** symbols = backtrace_symbols(violation.frames, violation.numFrames)) {
+                for (int frame = 0; frame < violation.numFrames; frame++)
+                    out << "    " << symbols[frame] << std::endl;
+                free(symbols);
+            }
+           #endif
+        }
+
+        if (getNumViolations() > (int) recorded.size())
+            out << (getNumViolations() - (int) recorded.size()) << " further violations were not recorded" << std::endl;
+    }
+}
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Debug instrumentation for real-time safety. processBlock marks itself as
+    a real-time section; tools that link the interposers in
+    Tools/RealtimeCheck then report any allocation, lock or blocking system
+    call made while such a section is on the stack of the calling thread.
+
+    Enabled by default in debug builds. Define OVOCODER_RT_CHECKS=0 or 1 to
+    override. When disabled the section marker compiles to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef OVOCODER_RT_CHECKS
+ #if JUCE_DEBUG
+  #define OVOCODER_RT_CHECKS 1
+ #else
+  #define OVOCODER_RT_CHECKS 0
+ #endif
+#endif
+
+namespace RealtimeGuard
+{
+    static constexpr int maxViolations = 256;
+    static constexpr int maxFrames = 24;
+
+    struct Violation
+    {
+        const char* kind = nullptr;
+        juce::uint64 threadId = 0;
+        int numFrames = 0;
+        void* frames[maxFrames] {};
+    };
+
+    // True while the calling thread is inside a real-time section and not
+    // already reporting a violation.
+    bool isActive() noexcept;
+
+    // Records a violation of the given kind (a string literal) with the
+    // current backtrace. Never allocates; violations beyond maxViolations
+    // are only counted.
+    void reportViolation(const char* kind) noexcept;
+
+    // Call once from a non real-time thread before processing starts, so
+    // that the backtrace machinery has done its lazy allocations.
+    void initialise();
+
+    int getNumViolations() noexcept;
+    std::vector<Violation> getViolations();
+    void clearViolations() noexcept;
+
+    // Writes every recorded violation with a symbolised backtrace.
+    void printViolations(std::ostream& out);
+
+    struct ScopedSection
+    {
+        ScopedSection() noexcept;
+        ~ScopedSection() noexcept;
+    };
+
+    // While one of these is alive, a mutex the calling thread gets without
+    // waiting is not reported; a contended one still is, as are allocations
+    // and blocking calls. For host-side code the plugin cannot change, such
+    // as the listener lock JUCE's wrappers take when they deliver parameter
+    // changes on the audio thread.
+    bool uncontendedLocksAllowed() noexcept;
+
+    struct ScopedUncontendedLocksAllowed
+    {
+        ScopedUncontendedLocksAllowed() noexcept;
+        ~ScopedUncontendedLocksAllowed() noexcept;
+    };
+}
+
+#if OVOCODER_RT_CHECKS
+ #define OVOCODER_REALTIME_SECTION RealtimeGuard::ScopedSection realtimeSection;
+#else
+ #define OVOCODER_REALTIME_SECTION
+#endif
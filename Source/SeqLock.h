@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    SeqLock.h
+    Single-writer sequence lock for small trivially copyable values. Writes
+    are wait-free and never block the audio thread; readers retry when they
+    overlap a write. The payload is held in relaxed atomic words, so it is
+    free of data races and also works when placed in shared memory.
+    SeqLockBuffer follows the same protocol for payloads whose size is only
+    known at run time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <thread>
+
+template <typename T>
+class SeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+    // Writer side; only one thread may write.
+    void write(const T& value) noexcept {
+        const auto sequenceBefore = sequence.load(std::memory_order_relaxed);
+        sequence.store(sequenceBefore + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        juce::uint64 source[numWords] = {};
+        std::memcpy(source, &value, sizeof(T));
+        for (int i = 0; i < numWords; i++)
+            words[i].store(source[i], std::memory_order_relaxed);
+
+        sequence.store(sequenceBefore + 2, std::memory_order_release);
+    }
+
+    // Returns false when a write was in progress or happened meanwhile.
+    bool tryRead(T& result) const noexcept {
+        const auto sequenceBefore = sequence.load(std::memory_order_acquire);
+        if ((sequenceBefore & 1) != 0)
+            return false;
+
+        juce::uint64 copy[numWords];
+        for (int i = 0; i < numWords; i++)
+            copy[i] = words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != sequenceBefore)
+            return false;
+
+        std::memcpy(&result, copy, sizeof(T));
+        return true;
+    }
+
+    // Retries until a consistent value is read. Never call this from the
+    // writer thread.
+    T read() const noexcept {
+        T result;
+        while (! tryRead(result))
+            std::this_thread::yield();
+        return result;
+    }
+
+    // Even number that grows by two per write; zero means never written.
+    juce::uint32 getSequence() const noexcept { return sequence.load(std::memory_order_acquire); }
+
+private:
+    static constexpr int numWords = (int) ((sizeof(T) + sizeof(juce::uint64) - 1) / sizeof(juce::uint64));
+
+    std::atomic<juce::uint32> sequence { 0 };
+    std::atomic<juce::uint64> words[numWords] {};
+};
+
+// A run of 32-bit words sized at construction. Writers and readers copy any
+// ranges they need between a begin/end pair, so a frame can be published
+// without copying the parts that are unused this block.
+class SeqLockBuffer
+{
+public:
+    explicit SeqLockBuffer(int numWordsToAllocate)
+        : numWords(numWordsToAllocate), words(new std::atomic<juce::uint32>[(size_t) numWordsToAllocate]()) {}
+
+    int getNumWords() const noexcept { return numWords; }
+
+    // Writer side; only one thread may write. Everything written between
+    // beginWrite and endWrite becomes visible to readers at once.
+    void beginWrite() noexcept {
+        const auto sequenceBefore = sequence.load(std::memory_order_relaxed);
+        sequence.store(sequenceBefore + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void write(int offset, const void* source, int numWordsToWrite) noexcept {
+        jassert(offset >= 0 && offset + numWordsToWrite <= numWords);
+        auto* bytes = static_cast<const char*>(source);
+        for (int i = 0; i < numWordsToWrite; i++) {
+            juce::uint32 word;
+            std::memcpy(&word, bytes + sizeof(word) * (size_t) i, sizeof(word));
+            words[(size_t) (offset + i)].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    void endWrite() noexcept {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Reader side. Copy the ranges after a successful beginRead and keep them
+    // only if endRead returns true; both return false on an overlapping write.
+    bool beginRead(juce::uint32& sequenceBefore) const noexcept {
+        sequenceBefore = sequence.load(std::memory_order_acquire);
+        return (sequenceBefore & 1) == 0;
+    }
+
+    void read(int offset, void* destination, int numWordsToRead) const noexcept {
+        jassert(offset >= 0 && offset + numWordsToRead <= numWords);
+        auto* bytes = static_cast<char*>(destination);
+        for (int i = 0; i < numWordsToRead; i++) {
+            const auto word = words[(size_t) (offset + i)].load(std::memory_order_relaxed);
+            std::memcpy(bytes + sizeof(word) * (size_t) i, &word, sizeof(word));
+        }
+    }
+
+    bool endRead(juce::uint32 sequenceBefore) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == sequenceBefore;
+    }
+
+private:
+    const int numWords;
+    std::atomic<juce::uint32> sequence { 0 };
+    std::unique_ptr<std::atomic<juce::uint32>[]> words;
+};
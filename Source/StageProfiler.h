@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    StageProfiler.h
+    Per-stage DSP load accounting for processBlock. The audio thread adds
+    cycle counts to the running stage and pushes one frame per block into a
+    lock-free ring; the editor drains the ring on its timer.
+
+    Compiled out with OVOCODER_STAGE_PROFILING=0: every call is then an
+    empty inline function and the call sites vanish. When compiled in but
+    not enabled, each mark costs a predictable branch.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CycleCounter.h"
+
+#ifndef OVOCODER_STAGE_PROFILING
+ #define OVOCODER_STAGE_PROFILING 1
+#endif
+
+class StageProfiler
+{
+public:
+    enum Stage
+    {
+        coefficientUpdate = 0,
+        correlation,
+        filterbank,
+        envelopes,
+        mix,
+        metering,
+        numStages
+    };
+
+    static const char* getStageName(int stage) {
+        static const char* names[numStages] = { "Coefficients", "Correlation", "Filterbank", "Envelopes", "Mix", "Metering" };
+        return names[stage];
+    }
+
+    struct Frame
+    {
+        juce::uint64 stageTicks[numStages] {};
+        juce::uint64 totalTicks = 0;
+        int numSamples = 0;
+    };
+
+   #if OVOCODER_STAGE_PROFILING
+    // Toggled from the message thread, e.g. while the editor is showing.
+    void setEnabled(bool shouldBeEnabled) noexcept { enabled.store(shouldBeEnabled); }
+    bool isEnabled() const noexcept { return enabled.load(); }
+
+    //==============================================================================
+    // Audio thread.
+    void beginBlock(int numSamples) noexcept {
+        active = enabled.load(std::memory_order_relaxed);
+        if (! active)
+            return;
+        current = {};
+        current.numSamples = numSamples;
+        blockStart = CycleCounter::now();
+    }
+
+    // Starts timing from now; the returned mark is passed to addSince().
+    juce::uint64 mark() const noexcept {
+        return active ? CycleCounter::now() : 0;
+    }
+
+    // Charges the time since `since` to the stage and moves the mark on.
+    void addSince(Stage stage, juce::uint64& since) noexcept {
+        if (! active)
+            return;
+        const auto now = CycleCounter::now();
+        current.stageTicks[stage] += now - since;
+        since = now;
+    }
+
+    void endBlock() noexcept {
+        if (! active)
+            return;
+        current.totalTicks = CycleCounter::now() - blockStart;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 > 0)
+            frames[(size_t) start1] = current;
+        fifo.finishedWrite(size1);
+        active = false;
+    }
+
+    //==============================================================================
+    // Reader side: sums every frame pushed since the last call. Returns the
+    // number of frames read.
+    int drain(Frame& sum) noexcept {
+        sum = {};
+        const int numReady = fifo.getNumReady();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numReady, start1, size1, start2, size2);
+        for (int i = 0; i < size1; i++)
+            accumulate(sum, frames[(size_t) (start1 + i)]);
+        for (int i = 0; i < size2; i++)
+            accumulate(sum, frames[(size_t) (start2 + i)]);
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    static constexpr int ringSize = 512;
+
+    std::atomic<bool> enabled { false };
+    bool active = false;
+    juce::uint64 blockStart = 0;
+    Frame current;
+
+    juce::AbstractFifo fifo { ringSize };
+    std::array<Frame, ringSize> frames;
+
+    static void accumulate(Frame& sum, const Frame& frame) noexcept {
+        for (int stage = 0; stage < numStages; stage++)
+            sum.stageTicks[stage] += frame.stageTicks[stage];
+        sum.totalTicks += frame.totalTicks;
+        sum.numSamples += frame.numSamples;
+    }
+   #else
+    void setEnabled(bool) noexcept {}
+    bool isEnabled() const noexcept { return false; }
+    void beginBlock(int) noexcept {}
+    juce::uint64 mark() const noexcept { return 0; }
+    void addSince(Stage, juce::uint64&) noexcept {}
+    void endBlock() noexcept {}
+    int drain(Frame& sum) noexcept { sum = {}; return 0; }
+   #endif
+};
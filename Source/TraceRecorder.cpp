@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+TraceRecorder::TraceRecorder()
+    : juce::Thread("Trace writer") {
+}
+
+TraceRecorder::~TraceRecorder() {
+    stop();
+}
+
+bool TraceRecorder::start(const juce::File& file) {
+    stop();
+
+    file.deleteFile();
+    stream = std::make_unique<juce::FileOutputStream>(file);
+    if (stream->failedToOpen()) {
+        stream.reset();
+        return false;
+    }
+
+    // Calibrate before the first event so the writer never stalls on it.
+    CycleCounter::getTicksPerSecond();
+
+    events.assign((size_t) ringSize, Event());
+    fifo.reset();
+    droppedEvents.store(0);
+    startTicks = CycleCounter::now();
+    firstEvent = true;
+    *stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    recording.store(true);
+    startThread();
+    return true;
+}
+
+void TraceRecorder::stop() {
+    if (stream == nullptr)
+        return;
+
+    recording.store(false);
+    stopThread(2000);
+
+    // A block that was running when recording stopped still finishes
+    // pushing its events before the ring goes away.
+    while (tracingBlock.load())
+        juce::Thread::yield();
+
+    flush();
+    *stream << "\n],\"otherData\":{\"droppedEvents\":" << droppedEvents.load() << "}}\n";
+    stream->flush();
+    stream.reset();
+    std::vector<Event>().swap(events);
+}
+
+void TraceRecorder::run() {
+    while (! threadShouldExit()) {
+        flush();
+        wait(50);
+    }
+}
+
+void TraceRecorder::flush() {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1; i++)
+        writeEvent(events[(size_t) (start1 + i)]);
+    for (int i = 0; i < size2; i++)
+        writeEvent(events[(size_t) (start2 + i)]);
+    fifo.finishedRead(size1 + size2);
+    stream->flush();
+}
+
+void TraceRecorder::writeEvent(const Event& event) {
+    const double microseconds = CycleCounter::ticksToSeconds(event.ticks - startTicks) * 1.0e6;
+
+    juce::String json;
+    json << (firstEvent ? "" : ",\n")
+         << "{\"name\":\"" << event.name << "\",\"cat\":\"dsp\",\"ph\":\"" << juce::String::charToString(event.phase)
+         << "\",\"ts\":" << juce::String(microseconds, 3) << ",\"pid\":1,\"tid\":" << juce::String((juce::int64) (event.threadId & 0x7fffffff));
+
+    if (event.phase == 'B' && event.blockSize > 0)
+        json << ",\"args\":{\"blockSize\":" << event.blockSize << ",\"bands\":" << event.numBands << ",\"order\":" << event.order << "}";
+
+    json << "}";
+    *stream << json;
+    firstEvent = false;
+}
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+    Opt-in timeline tracing of processBlock. The audio thread writes
+    begin/end events into a lock-free ring; a background thread drains it
+    into a Chrome trace-event JSON file that opens in Perfetto or
+    chrome://tracing. The ring only exists while recording: start()
+    allocates it and stop() frees it once no block is writing to it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CycleCounter.h"
+
+class TraceRecorder : private juce::Thread
+{
+public:
+    TraceRecorder();
+    ~TraceRecorder() override;
+
+    // Message thread. Starting truncates the file; stopping waits for a
+    // block that is being traced to finish, flushes what is left and closes
+    // the JSON array.
+    bool start(const juce::File& file);
+    void stop();
+    bool isRecording() const noexcept { return recording.load(); }
+
+    // Number of events lost because the ring was full.
+    int getNumDroppedEvents() const noexcept { return droppedEvents.load(); }
+
+    //==============================================================================
+    // Audio thread. beginBlock latches whether tracing is on for the block.
+    // A traced block holds tracingBlock; stop() sees either the flag or the
+    // block sees recording go false (both are sequentially consistent).
+    void beginBlock(int blockSize, int numBands, int order) noexcept {
+        active = recording.load(std::memory_order_relaxed);
+        if (! active)
+            return;
+
+        tracingBlock.store(true);
+        active = recording.load();
+        if (active)
+            push({ "processBlock", CycleCounter::now(), 'B', blockSize, numBands, order, getThreadId() });
+        else
+            tracingBlock.store(false);
+    }
+
+    void endBlock() noexcept {
+        if (active) {
+            push({ "processBlock", CycleCounter::now(), 'E', 0, 0, 0, getThreadId() });
+            tracingBlock.store(false);
+        }
+        active = false;
+    }
+
+    // name must be a string literal.
+    void begin(const char* name) noexcept {
+        if (active)
+            push({ name, CycleCounter::now(), 'B', 0, 0, 0, getThreadId() });
+    }
+
+    void end(const char* name) noexcept {
+        if (active)
+            push({ name, CycleCounter::now(), 'E', 0, 0, 0, getThreadId() });
+    }
+
+    struct Scope
+    {
+        Scope(TraceRecorder& r, const char* n) noexcept : recorder(r), name(n) { recorder.begin(name); }
+        ~Scope() noexcept { recorder.end(name); }
+
+        TraceRecorder& recorder;
+        const char* name;
+    };
+
+private:
+    struct Event
+    {
+        const char* name;
+        juce::uint64 ticks;
+        char phase;
+        int blockSize, numBands, order;
+        juce::uint64 threadId;
+    };
+
+    static constexpr int ringSize = 1 << 16;
+
+    std::atomic<bool> recording { false };
+    std::atomic<bool> tracingBlock { false };
+    std::atomic<int> droppedEvents { 0 };
+    bool active = false;
+
+    juce::AbstractFifo fifo { ringSize };
+    std::vector<Event> events;
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::uint64 startTicks = 0;
+    bool firstEvent = true;
+
+    static juce::uint64 getThreadId() noexcept {
+        return (juce::uint64) (juce::pointer_sized_uint) juce::Thread::getCurrentThreadId();
+    }
+
+    void push(const Event& event) noexcept {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0) {
+            droppedEvents.fetch_add(1);
+            return;
+        }
+        events[(size_t) start1] = event;
+        fifo.finishedWrite(1);
+    }
+
+    void run() override;
+    void flush();
+    void writeEvent(const Event& event);
+
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
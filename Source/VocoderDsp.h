@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+    VocoderDsp.h
+    Block kernels shared by processBlock and the benchmark tool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace VocoderDsp
+{
+    // Centre frequency of band i, spaced logarithmically between minF and maxF.
+    inline float getBandCenterFrequency(int band, int numBands, float minF, float maxF) {
+        float ratio;
+        if (numBands == 1) {
+            ratio = 0.0f;
+        } else {
+            ratio = static_cast<float>(band) / (numBands - 1);
+        }
+        return minF * std::pow(maxF / minF, ratio);
+    }
+
+    // State of one second-order stage: the two delays of a transposed direct
+    // form II biquad, or the two integrators of a state variable filter.
+    struct StageState
+    {
+        float z1 = 0.0f, z2 = 0.0f;
+    };
+
+    // Runs samples in place through the first `order` stages of a band's
+    // cascade, all with the same normalised biquad coefficients
+    // { b0, b1, b2, a1, a2 } (the raw layout of IIR::Coefficients). Same
+    // arithmetic as IIR::Filter::processSample.
+    inline void processBiquadCascade(StageState* stages, const float* c, int order, float* samples, int numSamples) {
+        for (int o = 0; o < order; o++) {
+            float z1 = stages[o].z1;
+            float z2 = stages[o].z2;
+            for (int sample = 0; sample < numSamples; sample++) {
+                const float input = samples[sample];
+                const float output = (c[0] * input) + z1;
+                z1 = (c[1] * input) - (c[3] * output) + z2;
+                z2 = (c[2] * input) - (c[4] * output);
+                samples[sample] = output;
+            }
+            stages[o].z1 = z1;
+            stages[o].z2 = z2;
+        }
+    }
+
+    // tan(x) for 0 <= x < pi/2 from its [5/4] Pade approximant; the relative
+    // error stays below 0.1% up to x = 1.43, i.e. 0.455 of the sample rate.
+    inline float fastTan(float x) {
+        const float x2 = x * x;
+        return x * (945.0f - 105.0f * x2 + x2 * x2) / (945.0f - 420.0f * x2 + 15.0f * x2 * x2);
+    }
+
+    // Band-pass in the topology-preserving state variable form (Zavalishin,
+    // Simper). It has the same bilinear-transformed response as the
+    // constant-peak-gain Coefficients::makeBandPass, but its coefficients
+    // take one fastTan and a division, so bands can be retuned every
+    // svfUpdateInterval samples without allocating.
+    static constexpr int svfUpdateInterval = 16;
+
+    struct SvfCoefficients
+    {
+        float k = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    };
+
+    inline SvfCoefficients makeSvfBandPass(float sampleRate, float centerFreq, float Q) {
+        const float g = fastTan(juce::MathConstants<float>::pi * juce::jmin(centerFreq / sampleRate, 0.455f));
+        SvfCoefficients coefficients;
+        coefficients.k = 1.0f / Q;
+        coefficients.a1 = 1.0f / (1.0f + g * (g + coefficients.k));
+        coefficients.a2 = g * coefficients.a1;
+        coefficients.a3 = g * coefficients.a2;
+        return coefficients;
+    }
+
+    // Like processBiquadCascade, with coefficients[segment * coefficientStride]
+    // used for the svfUpdateInterval-sample segment that starts at
+    // segment * svfUpdateInterval.
+    inline void processSvfCascade(StageState* stages, const SvfCoefficients* coefficients, int coefficientStride, int order, float* samples, int numSamples) {
+        for (int o = 0; o < order; o++) {
+            float ic1eq = stages[o].z1;
+            float ic2eq = stages[o].z2;
+            for (int start = 0, segment = 0; start < numSamples; start += svfUpdateInterval, segment++) {
+                const auto& c = coefficients[segment * coefficientStride];
+                const int end = juce::jmin(numSamples, start + svfUpdateInterval);
+                for (int sample = start; sample < end; sample++) {
+                    const float v3 = samples[sample] - ic2eq;
+                    const float v1 = c.a1 * ic1eq + c.a2 * v3;
+                    const float v2 = ic2eq + c.a2 * ic1eq + c.a3 * v3;
+                    ic1eq = 2.0f * v1 - ic1eq;
+                    ic2eq = 2.0f * v2 - ic2eq;
+                    samples[sample] = c.k * v1;
+                }
+            }
+            stages[o].z1 = ic1eq;
+            stages[o].z2 = ic2eq;
+        }
+    }
+
+    // Bands processed together by the group kernels (processBiquadBands,
+    // processSvfBands, followEnvelopes). A single band's filter or follower
+    // is bound by the latency of its feedback path; the bands of a group are
+    // independent, so running them interleaved sample by sample overlaps
+    // those latencies and lets the compiler keep a group's state in
+    // registers.
+    static constexpr int bandGroupSize = 4;
+
+    namespace detail
+    {
+        template <int NumBands>
+        inline void processBiquadBands(StageState* const* stages, const float* const* coefficients, int order, const float* input, float* const* outputs, int numSamples) {
+            for (int o = 0; o < order; o++) {
+                float b0[NumBands], b1[NumBands], b2[NumBands], a1[NumBands], a2[NumBands], z1[NumBands], z2[NumBands];
+                const float* sources[NumBands];
+                float* destinations[NumBands];
+                for (int b = 0; b < NumBands; b++) {
+                    b0[b] = coefficients[b][0];
+                    b1[b] = coefficients[b][1];
+                    b2[b] = coefficients[b][2];
+                    a1[b] = coefficients[b][3];
+                    a2[b] = coefficients[b][4];
+                    z1[b] = stages[b][o].z1;
+                    z2[b] = stages[b][o].z2;
+                    sources[b] = o == 0 ? input : outputs[b];
+                    destinations[b] = outputs[b];
+                }
+                for (int sample = 0; sample < numSamples; sample++) {
+                    for (int b = 0; b < NumBands; b++) {
+                        const float in = sources[b][sample];
+                        const float out = (b0[b] * in) + z1[b];
+                        z1[b] = (b1[b] * in) - (a1[b] * out) + z2[b];
+                        z2[b] = (b2[b] * in) - (a2[b] * out);
+                        destinations[b][sample] = out;
+                    }
+                }
+                for (int b = 0; b < NumBands; b++) {
+                    stages[b][o].z1 = z1[b];
+                    stages[b][o].z2 = z2[b];
+                }
+            }
+        }
+
+        template <int NumBands>
+        inline void followEnvelopes(float* states, const float* const* inputs, float* const* envelopes, int numSamples, float attackCoeff, float releaseCoeff) {
+            const float attack = 1.0f - attackCoeff;
+            const float release = 1.0f - releaseCoeff;
+            float currentStates[NumBands];
+            const float* sources[NumBands];
+            for (int b = 0; b < NumBands; b++) {
+                currentStates[b] = states[b];
+                sources[b] = inputs[b];
+            }
+            if (envelopes != nullptr) {
+                float* destinations[NumBands];
+                for (int b = 0; b < NumBands; b++)
+                    destinations[b] = envelopes[b];
+                for (int sample = 0; sample < numSamples; sample++) {
+                    for (int b = 0; b < NumBands; b++) {
+                        const float absoluteValue = std::abs(sources[b][sample]);
+                        currentStates[b] += (absoluteValue - currentStates[b]) * (absoluteValue > currentStates[b] ? attack : release);
+                        destinations[b][sample] = currentStates[b];
+                    }
+                }
+            } else {
+                for (int sample = 0; sample < numSamples; sample++) {
+                    for (int b = 0; b < NumBands; b++) {
+                        const float absoluteValue = std::abs(sources[b][sample]);
+                        currentStates[b] += (absoluteValue - currentStates[b]) * (absoluteValue > currentStates[b] ? attack : release);
+                    }
+                }
+            }
+            for (int b = 0; b < NumBands; b++)
+                states[b] = currentStates[b];
+        }
+
+        template <int NumBands>
+        inline void processSvfBands(StageState* const* stages, const SvfCoefficients* const* coefficients, int coefficientStride, int order, const float* input, float* const* outputs, int numSamples) {
+            for (int o = 0; o < order; o++) {
+                float ic1eq[NumBands], ic2eq[NumBands];
+                const float* sources[NumBands];
+                float* destinations[NumBands];
+                for (int b = 0; b < NumBands; b++) {
+                    ic1eq[b] = stages[b][o].z1;
+                    ic2eq[b] = stages[b][o].z2;
+                    sources[b] = o == 0 ? input : outputs[b];
+                    destinations[b] = outputs[b];
+                }
+                for (int start = 0, segment = 0; start < numSamples; start += svfUpdateInterval, segment++) {
+                    float k[NumBands], c1[NumBands], c2[NumBands], c3[NumBands];
+                    for (int b = 0; b < NumBands; b++) {
+                        const auto& c = coefficients[b][segment * coefficientStride];
+                        k[b] = c.k;
+                        c1[b] = c.a1;
+                        c2[b] = c.a2;
+                        c3[b] = c.a3;
+                    }
+                    const int end = juce::jmin(numSamples, start + svfUpdateInterval);
+                    for (int sample = start; sample < end; sample++) {
+                        for (int b = 0; b < NumBands; b++) {
+                            const float v3 = sources[b][sample] - ic2eq[b];
+                            const float v1 = c1[b] * ic1eq[b] + c2[b] * v3;
+                            const float v2 = ic2eq[b] + c2[b] * ic1eq[b] + c3[b] * v3;
+                            ic1eq[b] = 2.0f * v1 - ic1eq[b];
+                            ic2eq[b] = 2.0f * v2 - ic2eq[b];
+                            destinations[b][sample] = k[b] * v1;
+                        }
+                    }
+                }
+                for (int b = 0; b < NumBands; b++) {
+                    stages[b][o].z1 = ic1eq[b];
+                    stages[b][o].z2 = ic2eq[b];
+                }
+            }
+        }
+    }
+
+    // Filters input through the first `order` stages of numBands (at most
+    // bandGroupSize) bands at once: band i with stages[i] and coefficients[i],
+    // into outputs[i]. input must not alias any output. Per band the
+    // arithmetic is that of processBiquadCascade.
+    inline void processBiquadBands(StageState* const* stages, const float* const* coefficients, int numBands, int order, const float* input, float* const* outputs, int numSamples) {
+        switch (numBands) {
+            case 1: detail::processBiquadBands<1>(stages, coefficients, order, input, outputs, numSamples); break;
+            case 2: detail::processBiquadBands<2>(stages, coefficients, order, input, outputs, numSamples); break;
+            case 3: detail::processBiquadBands<3>(stages, coefficients, order, input, outputs, numSamples); break;
+            case 4: detail::processBiquadBands<4>(stages, coefficients, order, input, outputs, numSamples); break;
+            default: jassertfalse; break;
+        }
+    }
+
+    // processBiquadBands for the state variable filters; coefficients[i] is
+    // laid out as for processSvfCascade.
+    inline void processSvfBands(StageState* const* stages, const SvfCoefficients* const* coefficients, int coefficientStride, int numBands, int order, const float* input, float* const* outputs, int numSamples) {
+        switch (numBands) {
+            case 1: detail::processSvfBands<1>(stages, coefficients, coefficientStride, order, input, outputs, numSamples); break;
+            case 2: detail::processSvfBands<2>(stages, coefficients, coefficientStride, order, input, outputs, numSamples); break;
+            case 3: detail::processSvfBands<3>(stages, coefficients, coefficientStride, order, input, outputs, numSamples); break;
+            case 4: detail::processSvfBands<4>(stages, coefficients, coefficientStride, order, input, outputs, numSamples); break;
+            default: jassertfalse; break;
+        }
+    }
+
+    // Peak follower with separate attack/release smoothing. Writes the state
+    // after every sample to envelope (which may alias input) unless it is null.
+    inline void followEnvelope(float& state, const float* input, float* envelope, int numSamples, float attackCoeff, float releaseCoeff) {
+        float currentState = state;
+        for (int sample = 0; sample < numSamples; sample++) {
+            float absoluteValue = std::abs(input[sample]);
+            if (absoluteValue > currentState) {
+                currentState += (absoluteValue - currentState) * (1.0f - attackCoeff);
+            } else {
+                currentState -= (currentState - absoluteValue) * (1.0f - releaseCoeff);
+            }
+            if (envelope != nullptr)
+                envelope[sample] = currentState;
+        }
+        state = currentState;
+    }
+
+    // followEnvelope for numBands (at most bandGroupSize) bands at once, with
+    // the branch turned into a select so the bands' followers overlap. Gives
+    // the same states: moving towards the input by (1 - coeff) of the
+    // difference is exact in either direction. envelopes may be null, and
+    // envelopes[i] may alias inputs[i].
+    inline void followEnvelopes(float* states, const float* const* inputs, float* const* envelopes, int numBands, int numSamples, float attackCoeff, float releaseCoeff) {
+        switch (numBands) {
+            case 1: detail::followEnvelopes<1>(states, inputs, envelopes, numSamples, attackCoeff, releaseCoeff); break;
+            case 2: detail::followEnvelopes<2>(states, inputs, envelopes, numSamples, attackCoeff, releaseCoeff); break;
+            case 3: detail::followEnvelopes<3>(states, inputs, envelopes, numSamples, attackCoeff, releaseCoeff); break;
+            case 4: detail::followEnvelopes<4>(states, inputs, envelopes, numSamples, attackCoeff, releaseCoeff); break;
+            default: jassertfalse; break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    AnalysisCache.cpp
+
+  ==============================================================================
+*/
+
+#include "AnalysisCache.h"
+
+AnalysisCache::AnalysisCache(const juce::File& _directory)
+    : directory(_directory) {
+    directory.createDirectory();
+}
+
+juce::String AnalysisCache::getEntryName(const juce::File& modulator, const ModulatorAnalysis::Key& key) const {
+    const auto identity = modulator.getFullPathName() + "|" + juce::String(modulator.getSize()) + "|" + juce::String(modulator.getLastModificationTime().toMilliseconds());
+    return modulator.getFileNameWithoutExtension() + "_" + juce::String::toHexString(identity.hashCode64())
+         + "_" + juce::String::toHexString(key.toString().hashCode64()) + ".ovma";
+}
+
+AnalysisCache::Lease AnalysisCache::acquire(const juce::File& modulator, const ModulatorAnalysis::Key& key, int numChannels, juce::int64 numSamples) {
+    Lease lease;
+    lease.entryName = getEntryName(modulator, key);
+    const auto file = directory.getChildFile(lease.entryName);
+
+    std::lock_guard<std::mutex> scopedLock (lock);
+
+    if (recording.count(lease.entryName) > 0)
+        return lease;
+
+    auto found = openAnalyses.find(lease.entryName);
+    if (found == openAnalyses.end() && file.existsAsFile()) {
+        juce::String error;
+        if (auto analysis = ModulatorAnalysis::open(file, error))
+            found = openAnalyses.emplace(lease.entryName, std::move(analysis)).first;
+    }
+
+    if (found != openAnalyses.end() && found->second->getKey() == key
+        && found->second->getNumChannels() >= numChannels && found->second->getNumSamples() >= numSamples) {
+        lease.analysis = found->second;
+        lease.mode = OvocoderAudioProcessor::AnalysisMode::replay;
+        return lease;
+    }
+
+    // Missing, or too short for this carrier: record it again at the new
+    // length. Workers still replaying the old file keep their mapping; the
+    // new one only replaces it once it is complete.
+    if (found != openAnalyses.end())
+        openAnalyses.erase(found);
+
+    lease.recordingFile = file.withFileExtension(".tmp").getNonexistentSibling(false);
+    juce::String error;
+    if (auto analysis = ModulatorAnalysis::create(lease.recordingFile, key, numChannels, numSamples, error)) {
+        lease.analysis = std::move(analysis);
+        lease.mode = OvocoderAudioProcessor::AnalysisMode::record;
+        recording.insert(lease.entryName);
+    }
+    return lease;
+}
+
+void AnalysisCache::release(const Lease& lease, bool succeeded) {
+    if (lease.mode != OvocoderAudioProcessor::AnalysisMode::record)
+        return;
+
+    std::lock_guard<std::mutex> scopedLock (lock);
+    recording.erase(lease.entryName);
+
+    // The mapping follows the file through the rename.
+    if (succeeded) {
+        lease.analysis->markComplete();
+        if (lease.recordingFile.replaceFileIn(directory.getChildFile(lease.entryName)))
+            openAnalyses[lease.entryName] = lease.analysis;
+    } else {
+        lease.recordingFile.deleteFile();
+    }
+}
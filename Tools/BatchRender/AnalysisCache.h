@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    AnalysisCache.h
+    Directory of modulator analyses shared by all batch workers. The first
+    job that needs an analysis records it while rendering; later jobs with
+    the same modulator and analysis parameters replay it. Entries are named
+    after the modulator file (path, size and modification time) and the
+    analysis key, so a changed modulator or parameter set gets a new entry.
+    Recordings go to a temporary file that is renamed into place once they
+    are complete, so an entry that is mapped for replay is never rewritten.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include "../../Source/PluginProcessor.h"
+
+class AnalysisCache
+{
+public:
+    explicit AnalysisCache(const juce::File& directory);
+
+    struct Lease
+    {
+        std::shared_ptr<ModulatorAnalysis> analysis;
+        OvocoderAudioProcessor::AnalysisMode mode = OvocoderAudioProcessor::AnalysisMode::live;
+        juce::String entryName;
+        // Where a recording is written until release() renames it.
+        juce::File recordingFile;
+    };
+
+    // An analysis covering numSamples to replay, a new one to record, or a
+    // live lease when another worker is recording the same entry right now.
+    Lease acquire(const juce::File& modulator, const ModulatorAnalysis::Key& key, int numChannels, juce::int64 numSamples);
+
+    // Completes a recording, or discards it when the render failed.
+    void release(const Lease& lease, bool succeeded);
+
+private:
+    juce::String getEntryName(const juce::File& modulator, const ModulatorAnalysis::Key& key) const;
+
+    juce::File directory;
+
+    std::mutex lock;
+    std::set<juce::String> recording;
+    std::map<juce::String, std::shared_ptr<ModulatorAnalysis>> openAnalyses;
+};
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    BatchManifest.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchManifest.h"
+
+juce::Result BatchManifest::load(const juce::File& manifestFile, std::vector<BatchJob>& jobs) {
+    if (! manifestFile.existsAsFile())
+        return juce::Result::fail("Manifest not found: " + manifestFile.getFullPathName());
+
+    jobs.clear();
+
+    auto result = manifestFile.hasFileExtension("json") ? loadJson(manifestFile, jobs)
+                                                        : loadCsv(manifestFile, jobs);
+    if (result.failed())
+        return result;
+
+    for (size_t i = 0; i < jobs.size(); i++)
+        jobs[i].index = (int) i;
+
+    return juce::Result::ok();
+}
+
+juce::Result BatchManifest::loadCsv(const juce::File& manifestFile, std::vector<BatchJob>& jobs) {
+    // Blank lines are skipped rather than removed, so that errors can name
+    // the line of the file.
+    auto lines = juce::StringArray::fromLines(manifestFile.loadFileAsString());
+    lines.trim();
+
+    int headerLine = 0;
+    while (headerLine < lines.size() && lines[headerLine].isEmpty())
+        headerLine++;
+
+    if (headerLine == lines.size())
+        return juce::Result::fail("Manifest is empty: " + manifestFile.getFullPathName());
+
+    juce::StringArray columns;
+    columns.addTokens(lines[headerLine], ",", "\"");
+    columns.trim();
+
+    const int modulatorColumn = columns.indexOf("modulator", true);
+    const int carrierColumn = columns.indexOf("carrier", true);
+    const int unvoicedColumn = columns.indexOf("unvoiced", true);
+    const int outputColumn = columns.indexOf("output", true);
+    const int presetColumn = columns.indexOf("preset", true);
+
+    if (modulatorColumn < 0 || carrierColumn < 0 || outputColumn < 0)
+        return juce::Result::fail("CSV manifest needs at least modulator, carrier and output columns");
+
+    const auto baseDirectory = manifestFile.getParentDirectory();
+
+    for (int line = headerLine + 1; line < lines.size(); line++) {
+        if (lines[line].isEmpty() || lines[line].startsWithChar('#'))
+            continue;
+
+        juce::StringArray fields;
+        fields.addTokens(lines[line], ",", "\"");
+        fields.trim();
+
+        auto field = [&fields] (int column) {
+            return column >= 0 ? fields[column].unquoted().trim() : juce::String();
+        };
+
+        // The preset column is optional, but when present every row names one.
+        juce::StringArray missing;
+        for (auto [column, name] : { std::make_pair(modulatorColumn, "modulator"), std::make_pair(carrierColumn, "carrier"),
+                                     std::make_pair(outputColumn, "output"), std::make_pair(presetColumn, "preset") })
+            if (column >= 0 && field(column).isEmpty())
+                missing.add(name);
+
+        if (missing.size() > 0)
+            return juce::Result::fail("Line " + juce::String(line + 1) + ": empty " + missing.joinIntoString(", "));
+
+        BatchJob job;
+        job.modulator = resolvePath(field(modulatorColumn), baseDirectory);
+        job.carrier = resolvePath(field(carrierColumn), baseDirectory);
+        job.unvoiced = resolvePath(field(unvoicedColumn), baseDirectory);
+        job.output = resolvePath(field(outputColumn), baseDirectory);
+
+        auto presetResult = resolvePreset(field(presetColumn), baseDirectory, job);
+        if (presetResult.failed())
+            return juce::Result::fail("Line " + juce::String(line + 1) + ": " + presetResult.getErrorMessage());
+
+        jobs.push_back(job);
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result BatchManifest::loadJson(const juce::File& manifestFile, std::vector<BatchJob>& jobs) {
+    juce::var root;
+    auto parseResult = juce::JSON::parse(manifestFile.loadFileAsString(), root);
+    if (parseResult.failed())
+        return juce::Result::fail("Could not parse " + manifestFile.getFullPathName() + ": " + parseResult.getErrorMessage());
+
+    const auto jobList = root.isArray() ? root : root["jobs"];
+    if (! jobList.isArray())
+        return juce::Result::fail("JSON manifest needs an array of jobs");
+
+    const auto baseDirectory = manifestFile.getParentDirectory();
+
+    for (int i = 0; i < jobList.size(); i++) {
+        const auto& entry = jobList[i];
+
+        BatchJob job;
+        job.modulator = resolvePath(entry["modulator"].toString(), baseDirectory);
+        job.carrier = resolvePath(entry["carrier"].toString(), baseDirectory);
+        job.unvoiced = resolvePath(entry["unvoiced"].toString(), baseDirectory);
+        job.output = resolvePath(entry["output"].toString(), baseDirectory);
+
+        if (job.modulator == juce::File() || job.carrier == juce::File() || job.output == juce::File())
+            return juce::Result::fail("Job " + juce::String(i) + " needs modulator, carrier and output");
+
+        auto presetResult = resolvePreset(entry["preset"], baseDirectory, job);
+        if (presetResult.failed())
+            return juce::Result::fail("Job " + juce::String(i) + ": " + presetResult.getErrorMessage());
+
+        jobs.push_back(job);
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result BatchManifest::resolvePreset(const juce::var& presetField, const juce::File& baseDirectory, BatchJob& job) {
+    if (presetField.isObject()) {
+        job.preset = presetField;
+    } else if (presetField.toString().isNotEmpty()) {
+        auto presetFile = resolvePath(presetField.toString(), baseDirectory);
+        auto parseResult = juce::JSON::parse(presetFile.loadFileAsString(), job.preset);
+        if (parseResult.failed() || ! job.preset.isObject())
+            return juce::Result::fail("Could not read preset " + presetFile.getFullPathName());
+    } else {
+        job.preset = juce::var(new juce::DynamicObject());
+    }
+
+    job.presetKey = makePresetKey(job.preset);
+    return juce::Result::ok();
+}
+
+juce::File BatchManifest::resolvePath(const juce::String& path, const juce::File& baseDirectory) {
+    if (path.trim().isEmpty())
+        return {};
+    return juce::File::isAbsolutePath(path) ? juce::File(path) : baseDirectory.getChildFile(path);
+}
+
+juce::String BatchManifest::makePresetKey(const juce::var& preset) {
+    juce::StringArray entries;
+
+    // Numbers are normalised so that 16 and 16.0 share a key; anything else
+    // is keyed by its JSON text.
+    if (auto* object = preset.getDynamicObject()) {
+        for (const auto& property : object->getProperties()) {
+            const auto& value = property.value;
+            const bool isNumber = value.isInt() || value.isInt64() || value.isDouble();
+            entries.add(property.name.toString() + "=" + (isNumber ? juce::String((double) value) : juce::JSON::toString(value, true)));
+        }
+    }
+
+    entries.sort(false);
+    return entries.joinIntoString(";");
+}
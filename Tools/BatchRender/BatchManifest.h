@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    BatchManifest.h
+    Job list for the batch renderer, read from a CSV or JSON manifest.
+
+    CSV: a header row naming the columns, then one job per line:
+        modulator,carrier,unvoiced,output,preset
+    (unvoiced may be left empty; preset is a path to a JSON file mapping
+    parameter ids to values). Without a preset column every job uses the
+    default settings. Rows with an empty modulator, carrier, output or
+    preset are rejected with their line number.
+
+    JSON: either an array of jobs or { "jobs": [ ... ] }, where each job is
+        { "modulator": "...", "carrier": "...", "unvoiced": "...",
+          "output": "...", "preset": "preset.json" | { "num_bands": 16, ... } }
+
+    Relative paths are resolved against the manifest's directory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct BatchJob
+{
+    int index = 0;
+    juce::File modulator;
+    juce::File carrier;
+    juce::File unvoiced;
+    juce::File output;
+
+    // Parameter id -> value, applied on top of the parameter defaults.
+    juce::var preset;
+
+    // Canonical form of the preset, jobs with equal keys can share an engine.
+    juce::String presetKey;
+};
+
+class BatchManifest
+{
+public:
+    static juce::Result load(const juce::File& manifestFile, std::vector<BatchJob>& jobs);
+
+private:
+    static juce::Result loadCsv(const juce::File& manifestFile, std::vector<BatchJob>& jobs);
+    static juce::Result loadJson(const juce::File& manifestFile, std::vector<BatchJob>& jobs);
+    static juce::Result resolvePreset(const juce::var& presetField, const juce::File& baseDirectory, BatchJob& job);
+    static juce::File resolvePath(const juce::String& path, const juce::File& baseDirectory);
+    static juce::String makePresetKey(const juce::var& preset);
+};
@@ -0,0 +1,263 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+BatchRenderer::BatchRenderer(int _blockSize, int _bitsPerSample, AnalysisCache* _analysisCache)
+    : blockSize(_blockSize), bitsPerSample(_bitsPerSample), analysisCache(_analysisCache) {
+    formatManager.registerBasicFormats();
+}
+
+BatchJobResult BatchRenderer::render(const BatchJob& job, int workerIndex) {
+    return render(std::vector<const BatchJob*> { &job }, workerIndex).front();
+}
+
+std::vector<BatchJobResult> BatchRenderer::render(const std::vector<const BatchJob*>& jobs, int workerIndex) {
+    std::vector<BatchJobResult> results (jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        results[i].index = jobs[i]->index;
+        results[i].worker = workerIndex;
+    }
+
+    // Every job of a pass shares the first job's modulator and preset.
+    const auto& modulatorFile = jobs.front()->modulator;
+    std::unique_ptr<juce::AudioFormatReader> modulatorReader (formatManager.createReaderFor(modulatorFile));
+    if (modulatorReader == nullptr) {
+        for (auto& result : results)
+            result.error = "Could not read modulator " + modulatorFile.getFullPathName();
+        return results;
+    }
+
+    const double sampleRate = modulatorReader->sampleRate;
+    engineCapacity = juce::jmax(maxCachedEngines, (int) jobs.size());
+
+    std::vector<CarrierPass> passes;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        CarrierPass pass;
+        pass.job = jobs[i];
+        pass.result = &results[i];
+        if (openCarrier(pass, sampleRate, (int) passes.size()))
+            passes.push_back(std::move(pass));
+    }
+
+    if (passes.empty())
+        return results;
+
+    // The longest carrier leads: it runs the sidechain analysis for every
+    // block of the pass, the others replay its envelopes.
+    std::stable_sort(passes.begin(), passes.end(), [] (const CarrierPass& a, const CarrierPass& b) { return a.length > b.length; });
+    auto& lead = passes.front();
+    const juce::int64 totalNumSamples = lead.length;
+
+    AnalysisCache::Lease analysisLease;
+    if (analysisCache != nullptr)
+        analysisLease = analysisCache->acquire(modulatorFile, lead.processor->getAnalysisKey(blockSize), OvocoderAudioProcessor::numChannels, totalNumSamples);
+
+    // Without a cached analysis to share, the lead records each block into
+    // blockAnalysis and the other carriers replay it straight away.
+    const bool sharesCachedAnalysis = analysisLease.mode != OvocoderAudioProcessor::AnalysisMode::live;
+    std::unique_ptr<ModulatorAnalysis> blockAnalysis;
+    if (! sharesCachedAnalysis && passes.size() > 1)
+        blockAnalysis = ModulatorAnalysis::createInMemory(lead.processor->getAnalysisKey(blockSize), OvocoderAudioProcessor::numChannels, blockSize);
+
+    if (sharesCachedAnalysis) {
+        for (auto& pass : passes)
+            pass.processor->setModulatorAnalysis(analysisLease.analysis.get(), &pass == &lead ? analysisLease.mode : OvocoderAudioProcessor::AnalysisMode::replay);
+    }
+
+    lead.result->analysis = analysisLease.mode == OvocoderAudioProcessor::AnalysisMode::record ? "recorded"
+                          : analysisLease.mode == OvocoderAudioProcessor::AnalysisMode::replay ? "replayed" : "live";
+    for (size_t i = 1; i < passes.size(); i++)
+        passes[i].result->analysis = "shared";
+
+    const bool leadReadsModulator = analysisLease.mode != OvocoderAudioProcessor::AnalysisMode::replay;
+    bool modulatorReadFailed = false;
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    for (juce::int64 position = 0; position < totalNumSamples; position += blockSize) {
+        for (auto& pass : passes) {
+            if (position >= pass.length)
+                continue;
+
+            const int numSamples = (int) juce::jmin((juce::int64) blockSize, pass.length - position);
+            juce::AudioBuffer<float> block (ioBuffer.getArrayOfWritePointers(), pass.numChannels, numSamples);
+            block.clear();
+
+            readBlock(*pass.carrierReader, block, pass.mainChannel, position, numSamples);
+            if (&pass == &lead && leadReadsModulator && ! readBlock(*modulatorReader, block, pass.sidechainChannel, position, numSamples)
+                && ! modulatorReadFailed) {
+                modulatorReadFailed = true;
+                for (auto& failedPass : passes)
+                    failedPass.result->error = "Modulator read failed at sample " + juce::String(position);
+            }
+            if (pass.unvoicedReader != nullptr)
+                readBlock(*pass.unvoicedReader, block, pass.unvoicedChannel, position, numSamples);
+
+            if (blockAnalysis != nullptr)
+                pass.processor->setModulatorAnalysis(blockAnalysis.get(), &pass == &lead ? OvocoderAudioProcessor::AnalysisMode::record : OvocoderAudioProcessor::AnalysisMode::replay);
+
+            midiBuffer.clear();
+            pass.processor->processBlock(block, midiBuffer);
+
+            // A carrier whose output fails keeps processing, the others may
+            // still depend on its analysis.
+            if (pass.writer != nullptr && ! pass.writer->writeFromAudioSampleBuffer(block, 0, numSamples)) {
+                pass.result->error = "Write failed for " + pass.job->output.getFullPathName();
+                pass.writer.reset();
+            }
+        }
+    }
+
+    // The carriers of a pass are rendered together; each is charged an equal
+    // share of the pass, so the summary adds up to the time actually spent.
+    const double renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0 / (double) passes.size();
+
+    for (auto& pass : passes) {
+        pass.processor->setModulatorAnalysis(nullptr, OvocoderAudioProcessor::AnalysisMode::live);
+        if (pass.writer == nullptr)
+            continue;
+
+        pass.writer.reset();
+        pass.result->renderSeconds = renderSeconds;
+        pass.result->sampleRate = sampleRate;
+        pass.result->numSamples = pass.length;
+        pass.result->succeeded = ! modulatorReadFailed;
+    }
+
+    // The lead processed every block even if its own output failed, so a
+    // recording is complete unless the modulator could not be read.
+    if (analysisCache != nullptr)
+        analysisCache->release(analysisLease, ! modulatorReadFailed);
+
+    return results;
+}
+
+bool BatchRenderer::openCarrier(CarrierPass& pass, double sampleRate, int engineSlot) {
+    const auto& job = *pass.job;
+    auto& result = *pass.result;
+
+    pass.carrierReader.reset(formatManager.createReaderFor(job.carrier));
+    if (job.unvoiced != juce::File())
+        pass.unvoicedReader.reset(formatManager.createReaderFor(job.unvoiced));
+
+    if (pass.carrierReader == nullptr) {
+        result.error = "Could not read carrier " + job.carrier.getFullPathName();
+        return false;
+    }
+    if (job.unvoiced != juce::File() && pass.unvoicedReader == nullptr) {
+        result.error = "Could not read unvoiced input " + job.unvoiced.getFullPathName();
+        return false;
+    }
+    if (pass.carrierReader->sampleRate != sampleRate || (pass.unvoicedReader != nullptr && pass.unvoicedReader->sampleRate != sampleRate)) {
+        result.error = "Sample rates of the inputs do not match";
+        return false;
+    }
+
+    juce::String engineError;
+    pass.processor = getEngine(job, sampleRate, pass.unvoicedReader != nullptr, engineSlot, result.engineReused, engineError);
+    if (pass.processor == nullptr) {
+        result.error = engineError;
+        return false;
+    }
+
+    job.output.getParentDirectory().createDirectory();
+    job.output.deleteFile();
+
+    std::unique_ptr<juce::FileOutputStream> stream (job.output.createOutputStream());
+    if (stream == nullptr) {
+        result.error = "Could not create " + job.output.getFullPathName();
+        return false;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    pass.writer.reset(wavFormat.createWriterFor(stream.get(), sampleRate, 2, bitsPerSample, {}, 0));
+    if (pass.writer == nullptr) {
+        result.error = "Could not create a " + juce::String(bitsPerSample) + " bit writer for " + job.output.getFullPathName();
+        return false;
+    }
+    stream.release();
+
+    auto* processor = pass.processor;
+    pass.mainChannel = processor->getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::mainBusIndex, 0);
+    pass.sidechainChannel = processor->getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::sidechainBusIndex, 0);
+    pass.unvoicedChannel = pass.unvoicedReader != nullptr ? processor->getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::unvoicedBusIndex, 0) : -1;
+    pass.numChannels = juce::jmax(processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+    pass.length = pass.carrierReader->lengthInSamples;
+
+    if (ioBuffer.getNumChannels() < pass.numChannels || ioBuffer.getNumSamples() < blockSize)
+        ioBuffer.setSize(pass.numChannels, blockSize, false, false, true);
+    return true;
+}
+
+OvocoderAudioProcessor* BatchRenderer::getEngine(const BatchJob& job, double sampleRate, bool hasUnvoiced, int slot, bool& reused, juce::String& error) {
+    const auto key = job.presetKey + "|" + juce::String(sampleRate) + (hasUnvoiced ? "|unvoiced" : "") + "|" + juce::String(slot);
+
+    for (auto it = engines.begin(); it != engines.end(); ++it) {
+        if (it->key == key) {
+            auto engine = std::move(*it);
+            engines.erase(it);
+            engines.push_back(std::move(engine));
+
+            auto* processor = engines.back().processor.get();
+            processor->reset();
+            reused = true;
+            return processor;
+        }
+    }
+
+    // Renders offer the full band and order ranges; presets set plain values,
+    // so the wider parameter ranges change nothing for existing ones.
+    auto processor = std::make_unique<OvocoderAudioProcessor>(OvocoderAudioProcessor::Limits { OvocoderAudioProcessor::maxBands, OvocoderAudioProcessor::maxOrder });
+
+    error = applyPreset(*processor, job.preset);
+    if (error.isNotEmpty())
+        return nullptr;
+
+    auto layout = processor->getBusesLayout();
+    if (! hasUnvoiced)
+        layout.inputBuses.getReference(OvocoderAudioProcessor::unvoicedBusIndex) = juce::AudioChannelSet::disabled();
+    if (! processor->setBusesLayout(layout)) {
+        error = "Bus layout not supported";
+        return nullptr;
+    }
+
+    processor->setNonRealtime(true);
+    processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor->prepareToPlay(sampleRate, blockSize);
+
+    if ((int) engines.size() >= engineCapacity)
+        engines.erase(engines.begin());
+
+    engines.push_back({ key, std::move(processor) });
+    reused = false;
+    return engines.back().processor.get();
+}
+
+juce::String BatchRenderer::applyPreset(OvocoderAudioProcessor& processor, const juce::var& preset) {
+    if (auto* object = preset.getDynamicObject()) {
+        for (const auto& property : object->getProperties()) {
+            auto* parameter = processor.apvts.getParameter(property.name.toString());
+            if (parameter == nullptr)
+                return "Unknown parameter " + property.name.toString();
+
+            parameter->setValueNotifyingHost(parameter->convertTo0to1((float) property.value));
+        }
+    }
+    return {};
+}
+
+bool BatchRenderer::readBlock(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& buffer, int firstChannel, juce::int64 position, int numSamples) {
+    // A mono source is duplicated into both channels of the bus.
+    float* const* busChannels = buffer.getArrayOfWritePointers() + firstChannel;
+    const int numSourceChannels = juce::jmin(2, (int) reader.numChannels);
+    if (! reader.read(busChannels, numSourceChannels, position, numSamples))
+        return false;
+    if (numSourceChannels == 1)
+        juce::FloatVectorOperations::copy(busChannels[1], busChannels[0], numSamples);
+    return true;
+}
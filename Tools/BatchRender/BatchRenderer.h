@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.h
+    Renders batch jobs through headless OvocoderAudioProcessor instances.
+    Each worker owns one BatchRenderer; engines are kept per preset and sample
+    rate and reset (not re-prepared) between jobs, so jobs with identical
+    settings reuse the engine and its coefficient tables. With an analysis
+    cache, jobs that share a modulator and analysis parameters replay its
+    envelopes instead of re-analysing the sidechain.
+
+    A pass renders several carriers against one modulator: a lead engine
+    analyses the sidechain, and one engine per further carrier replays those
+    envelopes block by block, so the cost is one analysis plus one synthesis
+    filterbank per carrier.
+
+    The output has the carrier's length; shorter modulator and unvoiced files
+    are padded with silence, mono files feed both channels of their bus.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "BatchManifest.h"
+#include "AnalysisCache.h"
+
+struct BatchJobResult
+{
+    int index = 0;
+    bool succeeded = false;
+    juce::String error;
+    int worker = -1;
+    bool engineReused = false;
+    // "live", "recorded" or "replayed" modulator analysis.
+    juce::String analysis = "live";
+    double sampleRate = 0.0;
+    juce::int64 numSamples = 0;
+    // This job's equal share of its pass's wall time.
+    double renderSeconds = 0.0;
+
+    double getAudioSeconds() const { return sampleRate > 0.0 ? (double) numSamples / sampleRate : 0.0; }
+    double getRealtimeFactor() const { return renderSeconds > 0.0 ? getAudioSeconds() / renderSeconds : 0.0; }
+};
+
+class BatchRenderer
+{
+public:
+    // analysisCache may be null; when given, it is shared by all workers.
+    BatchRenderer(int blockSize, int bitsPerSample, AnalysisCache* analysisCache);
+
+    BatchJobResult render(const BatchJob& job, int workerIndex);
+
+    // Renders jobs that share a modulator and preset in one pass: the
+    // sidechain is analysed once per block and its envelopes drive every
+    // carrier's synthesis. Results are in the order of jobs.
+    std::vector<BatchJobResult> render(const std::vector<const BatchJob*>& jobs, int workerIndex);
+
+    static constexpr int maxCachedEngines = 4;
+
+private:
+    struct Engine
+    {
+        juce::String key;
+        std::unique_ptr<OvocoderAudioProcessor> processor;
+    };
+
+    struct CarrierPass
+    {
+        const BatchJob* job = nullptr;
+        BatchJobResult* result = nullptr;
+        OvocoderAudioProcessor* processor = nullptr;
+        std::unique_ptr<juce::AudioFormatReader> carrierReader, unvoicedReader;
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        int mainChannel = 0, sidechainChannel = 0, unvoicedChannel = -1, numChannels = 0;
+        juce::int64 length = 0;
+    };
+
+    bool openCarrier(CarrierPass& pass, double sampleRate, int engineSlot);
+
+    // Jobs of one pass use distinct slots so each gets its own engine.
+    OvocoderAudioProcessor* getEngine(const BatchJob& job, double sampleRate, bool hasUnvoiced, int slot, bool& reused, juce::String& error);
+    static juce::String applyPreset(OvocoderAudioProcessor& processor, const juce::var& preset);
+    // False if the reader failed; the block may then be partly filled.
+    static bool readBlock(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& buffer, int firstChannel, juce::int64 position, int numSamples);
+
+    int blockSize;
+    int bitsPerSample;
+    AnalysisCache* analysisCache;
+
+    // Most recently used engine last; grows to hold every engine of a pass.
+    std::vector<Engine> engines;
+    int engineCapacity = maxCachedEngines;
+
+    juce::AudioFormatManager formatManager;
+    juce::AudioBuffer<float> ioBuffer;
+    juce::MidiBuffer midiBuffer;
+};
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Offline batch renderer: runs every job of a manifest through the vocoder
+    on a work-stealing pool and writes a per-job summary.
+
+    Usage:
+        OvocoderBatchRender <manifest.csv|manifest.json>
+                            [--threads=N] [--block-size=N] [--bit-depth=16|24|32]
+                            [--summary=summary.csv|summary.json]
+                            [--analysis-cache=dir] [--carriers-per-pass=N]
+
+    With --analysis-cache, the sidechain analysis of each modulator is kept
+    in dir and replayed by later jobs with the same analysis parameters,
+    including those of later runs.
+
+    With --carriers-per-pass, up to N jobs sharing a modulator and preset are
+    rendered in one pass that analyses the modulator once for all of them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <map>
+#include "BatchManifest.h"
+#include "BatchRenderer.h"
+#include "WorkStealingPool.h"
+
+static juce::String csvField(const juce::String& text) {
+    return text.containsChar(',') || text.containsChar('"') ? text.replace("\"", "\"\"").quoted() : text;
+}
+
+static void writeSummary(const juce::File& summaryFile, const std::vector<BatchJob>& jobs, const std::vector<BatchJobResult>& results) {
+    if (summaryFile.hasFileExtension("json")) {
+        juce::var entries;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            const auto& result = results[i];
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("job", result.index);
+            entry->setProperty("output", jobs[i].output.getFullPathName());
+            entry->setProperty("status", result.succeeded ? "ok" : "failed");
+            entry->setProperty("error", result.error);
+            entry->setProperty("worker", result.worker);
+            entry->setProperty("engine_reused", result.engineReused);
+            entry->setProperty("analysis", result.analysis);
+            entry->setProperty("audio_seconds", result.getAudioSeconds());
+            entry->setProperty("render_seconds", result.renderSeconds);
+            entry->setProperty("realtime_factor", result.getRealtimeFactor());
+            entries.append(juce::var(entry));
+        }
+        summaryFile.replaceWithText(juce::JSON::toString(entries));
+        return;
+    }
+
+    juce::String csv = "job,carrier,modulator,output,status,error,worker,engine_reused,analysis,audio_seconds,render_seconds,realtime_factor\n";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const auto& job = jobs[i];
+        const auto& result = results[i];
+        csv += juce::String(result.index) + ","
+             + csvField(job.carrier.getFullPathName()) + ","
+             + csvField(job.modulator.getFullPathName()) + ","
+             + csvField(job.output.getFullPathName()) + ","
+             + (result.succeeded ? "ok" : "failed") + ","
+             + csvField(result.error) + ","
+             + juce::String(result.worker) + ","
+             + (result.engineReused ? "1" : "0") + ","
+             + result.analysis + ","
+             + juce::String(result.getAudioSeconds(), 3) + ","
+             + juce::String(result.renderSeconds, 3) + ","
+             + juce::String(result.getRealtimeFactor(), 2) + "\n";
+    }
+    summaryFile.replaceWithText(csv);
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() < 1 || args[0].isOption()) {
+        std::cerr << "Usage: " << args.executableName << " <manifest.csv|manifest.json> [--threads=N] [--block-size=N] [--bit-depth=16|24|32] [--summary=file] [--analysis-cache=dir] [--carriers-per-pass=N]" << std::endl;
+        return 1;
+    }
+
+    const auto manifestFile = args[0].resolveAsFile();
+    const int numThreads = args.containsOption("--threads") ? args.getValueForOption("--threads").getIntValue() : juce::SystemStats::getNumCpus();
+    const int blockSize = args.containsOption("--block-size") ? juce::jmax(1, args.getValueForOption("--block-size").getIntValue()) : 512;
+    const int bitsPerSample = args.containsOption("--bit-depth") ? args.getValueForOption("--bit-depth").getIntValue() : 24;
+    const int carriersPerPass = args.containsOption("--carriers-per-pass") ? juce::jmax(1, args.getValueForOption("--carriers-per-pass").getIntValue()) : 1;
+    const auto summaryFile = args.containsOption("--summary") ? juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--summary"))
+                                                              : manifestFile.withFileExtension("summary.csv");
+
+    std::vector<BatchJob> jobs;
+    auto loadResult = BatchManifest::load(manifestFile, jobs);
+    if (loadResult.failed()) {
+        std::cerr << loadResult.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    WorkStealingPool pool (juce::jlimit(1, (int) juce::jmax((size_t) 1, jobs.size()), numThreads));
+
+    std::unique_ptr<AnalysisCache> analysisCache;
+    if (args.containsOption("--analysis-cache"))
+        analysisCache = std::make_unique<AnalysisCache>(juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--analysis-cache")));
+
+    std::vector<std::unique_ptr<BatchRenderer>> renderers;
+    for (int i = 0; i < pool.getNumWorkers(); i++)
+        renderers.push_back(std::make_unique<BatchRenderer>(blockSize, bitsPerSample, analysisCache.get()));
+
+    std::vector<BatchJobResult> results (jobs.size());
+
+    // Jobs with the same modulator and preset are grouped into passes of up
+    // to carriersPerPass carriers, in manifest order.
+    std::vector<std::vector<const BatchJob*>> passes;
+    std::map<juce::String, size_t> openPasses;
+    for (const auto& job : jobs) {
+        const auto passKey = job.modulator.getFullPathName() + "|" + job.presetKey;
+        auto found = openPasses.find(passKey);
+        if (found == openPasses.end() || (int) passes[found->second].size() >= carriersPerPass) {
+            openPasses[passKey] = passes.size();
+            passes.emplace_back();
+        }
+        passes[openPasses[passKey]].push_back(&job);
+    }
+
+    // Passes sharing a preset start out on the same worker so they hit its
+    // engine cache; stealing evens out the load from there.
+    std::map<juce::String, int> presetWorkers;
+    for (const auto& pass : passes) {
+        const auto& presetKey = pass.front()->presetKey;
+        auto found = presetWorkers.find(presetKey);
+        const int worker = found != presetWorkers.end() ? found->second : (int) presetWorkers.size() % pool.getNumWorkers();
+        presetWorkers.emplace(presetKey, worker);
+
+        pool.submit(worker, [&pass, &results, &renderers] (int workerIndex) {
+            auto passResults = renderers[(size_t) workerIndex]->render(pass, workerIndex);
+            for (auto& result : passResults)
+                results[(size_t) result.index] = std::move(result);
+        });
+    }
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    pool.runAll();
+    const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    writeSummary(summaryFile, jobs, results);
+
+    int numFailed = 0;
+    double totalAudioSeconds = 0.0;
+    for (const auto& result : results) {
+        if (! result.succeeded) {
+            numFailed++;
+            std::cerr << "Job " << result.index << " failed: " << result.error << std::endl;
+        }
+        totalAudioSeconds += result.getAudioSeconds();
+    }
+
+    std::cout << jobs.size() - (size_t) numFailed << "/" << jobs.size() << " jobs rendered on "
+              << pool.getNumWorkers() << " workers (" << pool.getNumStolenTasks() << " stolen) in "
+              << wallSeconds << " s, " << (wallSeconds > 0.0 ? totalAudioSeconds / wallSeconds : 0.0) << "x realtime" << std::endl
+              << "Summary written to " << summaryFile.getFullPathName() << std::endl;
+
+    return numFailed == 0 ? 0 : 2;
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.h
+    Fixed set of worker threads, each with its own task deque. A worker pops
+    from the back of its own deque and steals from the front of the others
+    once it runs dry, so jobs queued together stay on one worker (and its
+    cached engines) unless another worker would otherwise sit idle.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void (int workerIndex)>;
+
+    explicit WorkStealingPool(int numWorkers) {
+        for (int i = 0; i < std::max(1, numWorkers); i++)
+            queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    int getNumWorkers() const { return (int) queues.size(); }
+    int getNumStolenTasks() const { return numStolen.load(); }
+
+    // Queues a task on a worker's own deque. Tasks are only submitted before
+    // runAll(), so an empty pool means all work is done.
+    void submit(int workerIndex, Task task) {
+        auto& queue = *queues[(size_t) (workerIndex % getNumWorkers())];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    // Runs every submitted task and returns once they have all finished.
+    void runAll() {
+        std::vector<std::thread> threads;
+
+        for (int worker = 0; worker < getNumWorkers(); worker++) {
+            threads.emplace_back([this, worker] {
+                Task task;
+                while (popLocal(worker, task) || steal(worker, task)) {
+                    task(worker);
+                    task = nullptr;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int worker, Task& task) {
+        auto& queue = *queues[(size_t) worker];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int thief, Task& task) {
+        const int numWorkers = getNumWorkers();
+        for (int offset = 1; offset < numWorkers; offset++) {
+            auto& queue = *queues[(size_t) ((thief + offset) % numWorkers)];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (! queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                numStolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<int> numStolen{0};
+};
@@ -0,0 +1,396 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Microbenchmarks for the vocoder's DSP kernels, each timed in isolation
+    over a sweep of band counts, filter orders and sample rates.
+
+    Usage:
+        OvocoderBenchmark [--kernels=filter_cascade,filter_bands,svf_cascade,svf_bands,envelope_follower,autocorrelation,coefficient_update]
+                          [--bands=3,8,16,32,48,64,128,256 | --bands=3-256] [--orders=1-8]
+                          [--sample-rates=44100,48000,96000,192000]
+                          [--block-size=N] [--seconds=S] [--repeats=N]
+                          [--label=text] [--json=results.json]
+
+    Kernels only sweep the dimensions they depend on: the envelope follower
+    ignores the order, the autocorrelation depends on the sample rate alone
+    and the coefficient update times building a band layout's coefficient
+    table, i.e. a miss in the shared cache. The SVF cascade
+    is timed with every band retuned each VocoderDsp::svfUpdateInterval
+    samples along a sweep, coefficient synthesis included. The _bands
+    variants run the same filters VocoderDsp::bandGroupSize bands at a time,
+    as the processor does; the _cascade ones one band at a time. For the
+    coefficient update the cycle figure is per band and per call rather than
+    per sample. Cycles come from CycleCounter, i.e. reference cycles of the
+    TSC on x86.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <functional>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/VocoderDsp.h"
+#include "../../Source/CorrelationTracker.h"
+#include "../../Source/CycleCounter.h"
+#include "../../Source/CoefficientCache.h"
+
+struct BenchmarkResult
+{
+    juce::String kernel;
+    double sampleRate = 0.0;
+    int bands = 0;
+    int order = 0;
+    double nsPerSample = 0.0;
+    double cyclesPerSamplePerBand = 0.0;
+    double nsPerCall = 0.0;
+};
+
+struct Timing
+{
+    double seconds = 0.0;
+    juce::uint64 cycles = 0;
+};
+
+// Best of `repeats` runs; the minimum is the least disturbed by the scheduler.
+static Timing measure(int repeats, const std::function<void()>& body) {
+    Timing best { std::numeric_limits<double>::max(), 0 };
+    for (int r = 0; r < repeats; r++) {
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        const auto startCycles = CycleCounter::now();
+        body();
+        const auto cycles = CycleCounter::now() - startCycles;
+        const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        if (seconds < best.seconds)
+            best = { seconds, cycles };
+    }
+    return best;
+}
+
+static juce::Array<int> parseIntList(const juce::String& text) {
+    juce::Array<int> values;
+    for (auto& token : juce::StringArray::fromTokens(text, ",", "")) {
+        if (token.containsChar('-')) {
+            const int first = token.upToFirstOccurrenceOf("-", false, false).getIntValue();
+            const int last = token.fromFirstOccurrenceOf("-", false, false).getIntValue();
+            for (int v = first; v <= last; v++)
+                values.add(v);
+        } else if (token.trim().isNotEmpty()) {
+            values.add(token.getIntValue());
+        }
+    }
+    return values;
+}
+
+static void fillNoise(juce::AudioBuffer<float>& buffer) {
+    juce::Random random (0x0c0de);
+    for (int channel = 0; channel < buffer.getNumChannels(); channel++) {
+        auto* data = buffer.getWritePointer(channel);
+        for (int sample = 0; sample < buffer.getNumSamples(); sample++)
+            data[sample] = random.nextFloat() * 2.0f - 1.0f;
+    }
+}
+
+class Benchmark
+{
+public:
+    int blockSize = 512;
+    double seconds = 0.25;
+    int repeats = 3;
+
+    std::vector<BenchmarkResult> results;
+
+    void runFilterCascade(double sampleRate, int bands, int order) {
+        std::vector<std::array<VocoderDsp::StageState, MAX_ORDER>> states ((size_t) bands);
+        CoefficientTable::Ptr table = new CoefficientTable({ sampleRate, bands, 20.0f, 20000.0f, 0.7071f });
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++) {
+                for (int band = 0; band < bands; band++) {
+                    scratch.copyFrom(0, 0, input, 0, 0, blockSize);
+                    VocoderDsp::processBiquadCascade(states[(size_t) band].data(), table->getBand(band), order, scratch.getWritePointer(0), blockSize);
+                }
+            }
+        });
+        addResult("filter_cascade", sampleRate, bands, order, timing, numBlocks);
+    }
+
+    void runSvfCascade(double sampleRate, int bands, int order) {
+        std::vector<std::array<VocoderDsp::StageState, MAX_ORDER>> states ((size_t) bands);
+        const int numSegments = (blockSize + VocoderDsp::svfUpdateInterval - 1) / VocoderDsp::svfUpdateInterval;
+        std::vector<VocoderDsp::SvfCoefficients> coefficients ((size_t) numSegments);
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++) {
+                for (int band = 0; band < bands; band++) {
+                    const float centerFreq = VocoderDsp::getBandCenterFrequency(band, bands, 20.0f, 20000.0f);
+                    for (int segment = 0; segment < numSegments; segment++) {
+                        const float sweep = 1.0f + 0.5f * (float) ((block * numSegments + segment) % 64) / 64.0f;
+                        coefficients[(size_t) segment] = VocoderDsp::makeSvfBandPass((float) sampleRate, centerFreq * sweep, 0.7071f);
+                    }
+                    scratch.copyFrom(0, 0, input, 0, 0, blockSize);
+                    VocoderDsp::processSvfCascade(states[(size_t) band].data(), coefficients.data(), 1, order, scratch.getWritePointer(0), blockSize);
+                }
+            }
+        });
+        addResult("svf_cascade", sampleRate, bands, order, timing, numBlocks);
+    }
+
+    // The kernels the processor runs: bands filtered VocoderDsp::bandGroupSize
+    // at a time, laid out as in DspStateArena.
+    void runFilterBands(double sampleRate, int bands, int order) {
+        std::vector<std::array<VocoderDsp::StageState, MAX_ORDER>> states ((size_t) bands);
+        CoefficientTable::Ptr table = new CoefficientTable({ sampleRate, bands, 20.0f, 20000.0f, 0.7071f });
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++) {
+                for (int groupStart = 0; groupStart < bands; groupStart += VocoderDsp::bandGroupSize) {
+                    const int groupBands = juce::jmin(VocoderDsp::bandGroupSize, bands - groupStart);
+                    VocoderDsp::StageState* groupStates[VocoderDsp::bandGroupSize];
+                    const float* groupCoefficients[VocoderDsp::bandGroupSize];
+                    for (int i = 0; i < groupBands; i++) {
+                        groupStates[i] = states[(size_t) (groupStart + i)].data();
+                        groupCoefficients[i] = table->getBand(groupStart + i);
+                    }
+                    VocoderDsp::processBiquadBands(groupStates, groupCoefficients, groupBands, order, input.getReadPointer(0), scratch.getArrayOfWritePointers(), blockSize);
+                }
+            }
+        });
+        addResult("filter_bands", sampleRate, bands, order, timing, numBlocks);
+    }
+
+    void runSvfBands(double sampleRate, int bands, int order) {
+        std::vector<std::array<VocoderDsp::StageState, MAX_ORDER>> states ((size_t) bands);
+        const int numSegments = (blockSize + VocoderDsp::svfUpdateInterval - 1) / VocoderDsp::svfUpdateInterval;
+        std::vector<VocoderDsp::SvfCoefficients> coefficients ((size_t) (numSegments * bands));
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++) {
+                for (int band = 0; band < bands; band++) {
+                    const float centerFreq = VocoderDsp::getBandCenterFrequency(band, bands, 20.0f, 20000.0f);
+                    for (int segment = 0; segment < numSegments; segment++) {
+                        const float sweep = 1.0f + 0.5f * (float) ((block * numSegments + segment) % 64) / 64.0f;
+                        coefficients[(size_t) (segment * bands + band)] = VocoderDsp::makeSvfBandPass((float) sampleRate, centerFreq * sweep, 0.7071f);
+                    }
+                }
+                for (int groupStart = 0; groupStart < bands; groupStart += VocoderDsp::bandGroupSize) {
+                    const int groupBands = juce::jmin(VocoderDsp::bandGroupSize, bands - groupStart);
+                    VocoderDsp::StageState* groupStates[VocoderDsp::bandGroupSize];
+                    const VocoderDsp::SvfCoefficients* groupCoefficients[VocoderDsp::bandGroupSize];
+                    for (int i = 0; i < groupBands; i++) {
+                        groupStates[i] = states[(size_t) (groupStart + i)].data();
+                        groupCoefficients[i] = coefficients.data() + groupStart + i;
+                    }
+                    VocoderDsp::processSvfBands(groupStates, groupCoefficients, bands, groupBands, order, input.getReadPointer(0), scratch.getArrayOfWritePointers(), blockSize);
+                }
+            }
+        });
+        addResult("svf_bands", sampleRate, bands, order, timing, numBlocks);
+    }
+
+    void runEnvelopeFollower(double sampleRate, int bands) {
+        std::vector<float> states ((size_t) bands, 0.0f);
+        const float attackCoeff = std::exp(-1.0f / (5.0f * (float) sampleRate / 1000.0f));
+        const float releaseCoeff = std::exp(-1.0f / (20.0f * (float) sampleRate / 1000.0f));
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++) {
+                for (int band = 0; band < bands; band++)
+                    VocoderDsp::followEnvelope(states[(size_t) band], input.getReadPointer(0), scratch.getWritePointer(0), blockSize, attackCoeff, releaseCoeff);
+            }
+        });
+        addResult("envelope_follower", sampleRate, bands, 0, timing, numBlocks);
+    }
+
+    void runAutocorrelation(double sampleRate) {
+        CorrelationTracker tracker;
+        tracker.prepare(sampleRate);
+        std::vector<float> storage ((size_t) tracker.getStorageSize());
+        tracker.setStorage(storage.data());
+        tracker.reset();
+
+        const int numBlocks = getNumBlocks(sampleRate);
+        auto timing = measure(repeats, [&] {
+            for (int block = 0; block < numBlocks; block++)
+                tracker.process(input.getReadPointer(0), scratch.getWritePointer(0), blockSize, true);
+        });
+        addResult("autocorrelation", sampleRate, 1, 0, timing, numBlocks);
+    }
+
+    void runCoefficientUpdate(double sampleRate, int bands) {
+        const CoefficientTable::Key key { sampleRate, bands, 20.0f, 20000.0f, 0.7071f };
+
+        const int numCalls = 64;
+        auto timing = measure(repeats, [&] {
+            for (int call = 0; call < numCalls; call++)
+                CoefficientTable::Ptr table = new CoefficientTable(key);
+        });
+
+        BenchmarkResult result;
+        result.kernel = "coefficient_update";
+        result.sampleRate = sampleRate;
+        result.bands = bands;
+        result.nsPerCall = timing.seconds * 1.0e9 / numCalls;
+        result.cyclesPerSamplePerBand = (double) timing.cycles / ((double) numCalls * bands);
+        results.push_back(result);
+        print(result);
+    }
+
+    void prepareInput() {
+        input.setSize(1, blockSize);
+        scratch.setSize(VocoderDsp::bandGroupSize, blockSize);
+        fillNoise(input);
+    }
+
+    static void printHeader() {
+        std::cout << juce::String("kernel").paddedRight(' ', 20) << juce::String("rate").paddedLeft(' ', 8)
+                  << juce::String("bands").paddedLeft(' ', 7) << juce::String("order").paddedLeft(' ', 7)
+                  << juce::String("ns/sample").paddedLeft(' ', 13) << juce::String("cyc/smp/band").paddedLeft(' ', 14)
+                  << juce::String("ns/call").paddedLeft(' ', 12) << std::endl;
+    }
+
+private:
+    juce::AudioBuffer<float> input, scratch;
+
+    int getNumBlocks(double sampleRate) const {
+        return juce::jmax(1, juce::roundToInt(seconds * sampleRate / blockSize));
+    }
+
+    void addResult(const juce::String& kernel, double sampleRate, int bands, int order, const Timing& timing, int numBlocks) {
+        const double numSamples = (double) numBlocks * blockSize;
+        BenchmarkResult result;
+        result.kernel = kernel;
+        result.sampleRate = sampleRate;
+        result.bands = bands;
+        result.order = order;
+        result.nsPerSample = timing.seconds * 1.0e9 / numSamples;
+        result.cyclesPerSamplePerBand = (double) timing.cycles / (numSamples * bands);
+        results.push_back(result);
+        print(result);
+    }
+
+    static void print(const BenchmarkResult& result) {
+        std::cout << result.kernel.paddedRight(' ', 20) << juce::String((int) result.sampleRate).paddedLeft(' ', 8)
+                  << juce::String(result.bands).paddedLeft(' ', 7) << (result.order > 0 ? juce::String(result.order) : juce::String("-")).paddedLeft(' ', 7)
+                  << (result.nsPerSample > 0.0 ? juce::String(result.nsPerSample, 2) : juce::String("-")).paddedLeft(' ', 13)
+                  << juce::String(result.cyclesPerSamplePerBand, 2).paddedLeft(' ', 14)
+                  << (result.nsPerCall > 0.0 ? juce::String(result.nsPerCall, 0) : juce::String("-")).paddedLeft(' ', 12) << std::endl;
+    }
+};
+
+static void writeJson(const juce::File& file, const Benchmark& benchmark, const juce::String& label) {
+    auto* meta = new juce::DynamicObject();
+    meta->setProperty("label", label);
+    meta->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+    meta->setProperty("cpu_model", juce::SystemStats::getCpuModel());
+    meta->setProperty("cpu_mhz", juce::SystemStats::getCpuSpeedInMegahertz());
+    meta->setProperty("num_cpus", juce::SystemStats::getNumCpus());
+    meta->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    meta->setProperty("cycle_counter_hz", CycleCounter::getTicksPerSecond());
+    meta->setProperty("block_size", benchmark.blockSize);
+    meta->setProperty("seconds", benchmark.seconds);
+    meta->setProperty("repeats", benchmark.repeats);
+
+    juce::var entries;
+    for (const auto& result : benchmark.results) {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("kernel", result.kernel);
+        entry->setProperty("sample_rate", result.sampleRate);
+        entry->setProperty("bands", result.bands);
+        entry->setProperty("order", result.order);
+        entry->setProperty("ns_per_sample", result.nsPerSample);
+        entry->setProperty("cycles_per_sample_per_band", result.cyclesPerSamplePerBand);
+        entry->setProperty("ns_per_call", result.nsPerCall);
+        entries.append(juce::var(entry));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("meta", juce::var(meta));
+    root->setProperty("results", entries);
+    file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    auto option = [&args] (const char* name, const juce::String& fallback) {
+        return args.containsOption(name) ? args.getValueForOption(name) : fallback;
+    };
+
+    const auto kernels = juce::StringArray::fromTokens(option("--kernels", "filter_cascade,filter_bands,svf_cascade,svf_bands,envelope_follower,autocorrelation,coefficient_update"), ",", "");
+    const auto bandCounts = parseIntList(option("--bands", "3,8,16,32,48,64,128,256"));
+    const auto orders = parseIntList(option("--orders", "1-8"));
+    const auto sampleRates = parseIntList(option("--sample-rates", "44100,48000,96000,192000"));
+
+    for (int bands : bandCounts) {
+        if (bands < 1 || bands > MAX_BANDS) {
+            std::cerr << "Band count " << bands << " is outside 1.." << MAX_BANDS << std::endl;
+            return 1;
+        }
+    }
+    for (int order : orders) {
+        if (order < 1 || order > MAX_ORDER) {
+            std::cerr << "Order " << order << " is outside 1.." << MAX_ORDER << std::endl;
+            return 1;
+        }
+    }
+
+    Benchmark benchmark;
+    benchmark.blockSize = juce::jmax(1, option("--block-size", "512").getIntValue());
+    benchmark.seconds = juce::jmax(0.01, option("--seconds", "0.25").getDoubleValue());
+    benchmark.repeats = juce::jmax(1, option("--repeats", "3").getIntValue());
+    benchmark.prepareInput();
+
+    std::cout << juce::SystemStats::getCpuModel() << ", cycle counter at "
+              << juce::String(CycleCounter::getTicksPerSecond() / 1.0e6, 1) << " MHz" << std::endl;
+    Benchmark::printHeader();
+
+    for (int sampleRate : sampleRates) {
+        if (kernels.contains("filter_cascade"))
+            for (int bands : bandCounts)
+                for (int order : orders)
+                    benchmark.runFilterCascade(sampleRate, bands, order);
+
+        if (kernels.contains("filter_bands"))
+            for (int bands : bandCounts)
+                for (int order : orders)
+                    benchmark.runFilterBands(sampleRate, bands, order);
+
+        if (kernels.contains("svf_cascade"))
+            for (int bands : bandCounts)
+                for (int order : orders)
+                    benchmark.runSvfCascade(sampleRate, bands, order);
+
+        if (kernels.contains("svf_bands"))
+            for (int bands : bandCounts)
+                for (int order : orders)
+                    benchmark.runSvfBands(sampleRate, bands, order);
+
+        if (kernels.contains("envelope_follower"))
+            for (int bands : bandCounts)
+                benchmark.runEnvelopeFollower(sampleRate, bands);
+
+        if (kernels.contains("autocorrelation"))
+            benchmark.runAutocorrelation(sampleRate);
+
+        if (kernels.contains("coefficient_update"))
+            for (int bands : bandCounts)
+                benchmark.runCoefficientUpdate(sampleRate, bands);
+    }
+
+    if (args.containsOption("--json")) {
+        const auto jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--json"));
+        writeJson(jsonFile, benchmark, option("--label", {}));
+        std::cout << "Wrote " << jsonFile.getFullPathName() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Converts an envelope capture (see EnvelopeCapture.h) to CSV with one row
+    per frame and channel. Band columns beyond a frame's band count are left
+    empty.
+
+    Usage:
+        OvocoderEnvelopeExport capture.ovec [--output=capture.csv]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/EnvelopeCapture.h"
+
+struct CaptureFrame
+{
+    juce::int64 startSample = 0;
+    int numSamples = 0, sampleRate = 0, numChannels = 0, numBands = 0;
+    std::vector<float> correlation, envelopes;
+};
+
+static bool readHeader(juce::InputStream& input, juce::String& error) {
+    char magic[4] = {};
+    if (input.read(magic, 4) != 4 || std::memcmp(magic, "OVEC", 4) != 0) {
+        error = "Not an envelope capture";
+        return false;
+    }
+    const int version = input.readInt();
+    if (version != EnvelopeCapture::fileVersion) {
+        error = "Unsupported capture version " + juce::String(version);
+        return false;
+    }
+    return true;
+}
+
+// Returns false at the end of the file or on a truncated last frame, which
+// is what a capture still being written ends with.
+static bool readFrame(juce::InputStream& input, CaptureFrame& frame) {
+    if (input.getNumBytesRemaining() < 24)
+        return false;
+
+    frame.startSample = input.readInt64();
+    frame.numSamples = input.readInt();
+    frame.sampleRate = input.readInt();
+    frame.numChannels = input.readInt();
+    frame.numBands = input.readInt();
+
+    if (frame.numChannels < 0 || frame.numBands < 0)
+        return false;
+    const juce::int64 payloadBytes = (juce::int64) sizeof(float) * frame.numChannels * (1 + frame.numBands);
+    if (input.getNumBytesRemaining() < payloadBytes)
+        return false;
+
+    frame.correlation.resize((size_t) frame.numChannels);
+    frame.envelopes.resize((size_t) (frame.numChannels * frame.numBands));
+    for (auto& value : frame.correlation)
+        value = input.readFloat();
+    for (auto& value : frame.envelopes)
+        value = input.readFloat();
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() < 1 || args[0].isOption()) {
+        std::cerr << "Usage: OvocoderEnvelopeExport capture.ovec [--output=capture.csv]" << std::endl;
+        return 1;
+    }
+
+    const auto inputFile = args[0].resolveAsExistingFile();
+    const auto outputFile = args.containsOption("--output") ? args.getFileForOption("--output") : inputFile.withFileExtension("csv");
+
+    juce::FileInputStream input (inputFile);
+    if (input.failedToOpen()) {
+        std::cerr << "Could not open " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    juce::String error;
+    if (! readHeader(input, error)) {
+        std::cerr << error << ": " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // First pass finds the widest frame so every row has the same columns.
+    const auto dataStart = input.getPosition();
+    CaptureFrame frame;
+    int maxBands = 0, numFrames = 0;
+    while (readFrame(input, frame)) {
+        maxBands = juce::jmax(maxBands, frame.numBands);
+        numFrames++;
+    }
+    input.setPosition(dataStart);
+
+    outputFile.deleteFile();
+    juce::FileOutputStream output (outputFile);
+    if (output.failedToOpen()) {
+        std::cerr << "Could not create " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    output << "start_sample,time_seconds,num_samples,sample_rate,channel,num_bands,correlation";
+    for (int band = 0; band < maxBands; band++)
+        output << ",band_" << band;
+    output << "\n";
+
+    while (readFrame(input, frame)) {
+        const double time = frame.sampleRate > 0 ? (double) frame.startSample / frame.sampleRate : 0.0;
+        for (int channel = 0; channel < frame.numChannels; channel++) {
+            juce::String row;
+            row << juce::String(frame.startSample) << "," << juce::String(time, 6) << "," << frame.numSamples << ","
+                << frame.sampleRate << "," << channel << "," << frame.numBands << "," << juce::String(frame.correlation[(size_t) channel], 6);
+            for (int band = 0; band < maxBands; band++) {
+                row << ",";
+                if (band < frame.numBands)
+                    row << juce::String(frame.envelopes[(size_t) (channel * frame.numBands + band)], 6);
+            }
+            output << row << "\n";
+        }
+    }
+
+    output.flush();
+    std::cout << "Wrote " << numFrames << " frames of up to " << maxBands << " bands to " << outputFile.getFullPathName() << std::endl;
+    return 0;
+}
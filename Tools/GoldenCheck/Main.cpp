@@ -0,0 +1,472 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Golden-output regression check. Renders a fixed set of synthetic (and
+    optionally recorded) signals through a set of presets, and either
+    records the outputs and band envelope traces as golden files or
+    compares a build against previously recorded ones.
+
+    Usage:
+        OvocoderGoldenCheck --golden=<dir> [--record] [--recordings=<dir>]
+                            [--engines=reference]
+
+    Recordings are picked up as <name>.carrier.wav / <name>.modulator.wav
+    pairs. Every engine variant is compared against the golden files that
+    were recorded with the reference engine: bit-exact where the variant
+    claims to be exact, otherwise within its dB error bound. Golden files
+    are only reproducible on the platform and compiler they were recorded
+    with. Returns 1 when any case diverges.
+
+    The golden files belong in Tools/GoldenCheck/Goldens; `make -C Tools
+    GoldenRecord` records them with the current build and `make -C Tools
+    GoldenTest` checks every engine variant against them (see Tools/Makefile).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/PluginProcessor.h"
+
+static constexpr double goldenSampleRate = 48000.0;
+static constexpr int goldenBlockSize = 256;
+static constexpr int traceMagic = 0x4f565452; // "OVTR"
+
+struct EngineVariant
+{
+    juce::String name;
+    // 0 means bit-exact; otherwise the error must stay this many dB below
+    // the reference signal.
+    double toleranceDb = 0.0;
+    std::function<void(OvocoderAudioProcessor&)> configure;
+};
+
+static std::vector<EngineVariant> getEngineVariants() {
+    return {
+        { "reference", 0.0, [] (OvocoderAudioProcessor& processor) {
+            processor.setSilenceSleepEnabled(false);
+            processor.setBandSkippingEnabled(false);
+            processor.setSvfFiltersEnabled(false);
+        } },
+        // A skipped band's envelope times its carrier level times the wet
+        // gain is below -100 dB, so whatever it would have added stays far
+        // below the signal.
+        { "band_skipping", 80.0, [] (OvocoderAudioProcessor& processor) {
+            processor.setSilenceSleepEnabled(false);
+            processor.setBandSkippingEnabled(true);
+            processor.setSvfFiltersEnabled(false);
+        } },
+        // Same response as the biquads; the differences are rounding in the
+        // other topology and the fastTan error, which detunes the top bands
+        // by under 0.1%.
+        { "svf", 50.0, [] (OvocoderAudioProcessor& processor) {
+            processor.setSilenceSleepEnabled(false);
+            processor.setBandSkippingEnabled(false);
+            processor.setSvfFiltersEnabled(true);
+        } },
+        // The engine only sleeps once the filter tails have decayed below
+        // -120 dB; waking up from cleared states and the closed-form release
+        // of the followers stay well below the signal.
+        { "silence_sleep", 80.0, [] (OvocoderAudioProcessor& processor) {
+            processor.setSilenceSleepEnabled(true);
+            processor.setBandSkippingEnabled(false);
+            processor.setSvfFiltersEnabled(false);
+        } },
+    };
+}
+
+struct GoldenPreset
+{
+    juce::String name;
+    juce::NamedValueSet parameters;
+    bool useUnvoiced = false;
+};
+
+static std::vector<GoldenPreset> getPresets() {
+    std::vector<GoldenPreset> presets;
+
+    presets.push_back({ "default", {}, false });
+
+    GoldenPreset dense { "dense", {}, false };
+    dense.parameters.set("num_bands", 64.0f);
+    dense.parameters.set("order", 8.0f);
+    dense.parameters.set("q", 4.0f);
+    presets.push_back(dense);
+
+    GoldenPreset sparse { "sparse", {}, false };
+    sparse.parameters.set("num_bands", 3.0f);
+    sparse.parameters.set("order", 1.0f);
+    sparse.parameters.set("mix", 0.5f);
+    sparse.parameters.set("attack", 0.5f);
+    sparse.parameters.set("release", 200.0f);
+    presets.push_back(sparse);
+
+    GoldenPreset correlation { "correlation", {}, true };
+    correlation.parameters.set("correlation_enabled", 1.0f);
+    correlation.parameters.set("num_bands", 16.0f);
+    correlation.parameters.set("gain", 6.0f);
+    presets.push_back(correlation);
+
+    // The largest layout the limits allow, so the wide band and order paths
+    // are covered as well.
+    GoldenPreset wide { "wide", {}, false };
+    wide.parameters.set("num_bands", (float) OvocoderAudioProcessor::maxBands);
+    wide.parameters.set("order", (float) OvocoderAudioProcessor::maxOrder);
+    wide.parameters.set("q", 20.0f);
+    wide.parameters.set("min_freq", 60.0f);
+    wide.parameters.set("max_freq", 16000.0f);
+    presets.push_back(wide);
+
+    return presets;
+}
+
+struct GoldenSignal
+{
+    juce::String name;
+    juce::AudioBuffer<float> carrier, modulator;
+};
+
+static std::vector<GoldenSignal> makeSyntheticSignals() {
+    const int numSamples = (int) goldenSampleRate * 2;
+    std::vector<GoldenSignal> signals;
+
+    auto add = [&] (const juce::String& name, std::function<void(int, float&, float&)> generate) {
+        GoldenSignal signal { name, juce::AudioBuffer<float>(2, numSamples), juce::AudioBuffer<float>(2, numSamples) };
+        for (int sample = 0; sample < numSamples; sample++) {
+            float carrier = 0.0f, modulator = 0.0f;
+            generate(sample, carrier, modulator);
+            for (int channel = 0; channel < 2; channel++) {
+                signal.carrier.setSample(channel, sample, carrier);
+                signal.modulator.setSample(channel, sample, modulator);
+            }
+        }
+        signals.push_back(std::move(signal));
+    };
+
+    juce::Random random (0x601d);
+
+    add("saw_noise", [&random] (int sample, float& carrier, float& modulator) {
+        const double phase = std::fmod(sample * 110.0 / goldenSampleRate, 1.0);
+        carrier = (float) (2.0 * phase - 1.0) * 0.5f;
+        modulator = (random.nextFloat() * 2.0f - 1.0f) * 0.5f;
+    });
+
+    add("pulse_vowel", [] (int sample, float& carrier, float& modulator) {
+        // Pulse train carrier against a two-formant modulator with a 4 Hz
+        // amplitude contour, a crude stand-in for speech.
+        carrier = sample % 400 == 0 ? 1.0f : 0.0f;
+        const double t = sample / goldenSampleRate;
+        const double contour = 0.5 + 0.5 * std::sin(juce::MathConstants<double>::twoPi * 4.0 * t);
+        modulator = (float) (contour * (0.4 * std::sin(juce::MathConstants<double>::twoPi * 700.0 * t)
+                                      + 0.2 * std::sin(juce::MathConstants<double>::twoPi * 1200.0 * t)));
+    });
+
+    add("chirp", [] (int sample, float& carrier, float& modulator) {
+        const double t = sample / goldenSampleRate;
+        const double duration = numSamples / goldenSampleRate;
+        const double f0 = 20.0, f1 = 20000.0;
+        const double k = std::log(f1 / f0) / duration;
+        const double phase = juce::MathConstants<double>::twoPi * f0 * (std::exp(k * t) - 1.0) / k;
+        carrier = (float) std::sin(phase) * 0.5f;
+        modulator = (float) std::sin(phase * 0.5) * 0.5f;
+    });
+
+    add("impulses", [] (int sample, float& carrier, float& modulator) {
+        carrier = sample % 4800 == 0 ? 1.0f : 0.0f;
+        modulator = sample % 9600 == 0 ? 1.0f : 0.0f;
+    });
+
+    add("silence", [] (int, float& carrier, float& modulator) {
+        carrier = 0.0f;
+        modulator = 0.0f;
+    });
+
+    return signals;
+}
+
+static bool loadRecording(juce::AudioFormatManager& formatManager, const juce::File& file, juce::AudioBuffer<float>& buffer) {
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->sampleRate != goldenSampleRate)
+        return false;
+
+    buffer.setSize(2, (int) reader->lengthInSamples);
+    reader->read(&buffer, 0, (int) reader->lengthInSamples, 0, true, true);
+    return true;
+}
+
+static void addRecordings(std::vector<GoldenSignal>& signals, const juce::File& directory) {
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    for (const auto& carrierFile : directory.findChildFiles(juce::File::findFiles, false, "*.carrier.wav")) {
+        const auto name = carrierFile.getFileName().upToFirstOccurrenceOf(".carrier.wav", false, true);
+        const auto modulatorFile = directory.getChildFile(name + ".modulator.wav");
+
+        GoldenSignal signal { "rec_" + name, {}, {} };
+        if (! loadRecording(formatManager, carrierFile, signal.carrier) || ! loadRecording(formatManager, modulatorFile, signal.modulator)) {
+            std::cerr << "Skipping recording " << name << ": needs a " << goldenSampleRate << " Hz carrier and modulator" << std::endl;
+            continue;
+        }
+
+        const int numSamples = juce::jmin(signal.carrier.getNumSamples(), signal.modulator.getNumSamples());
+        signal.carrier.setSize(2, numSamples, true);
+        signal.modulator.setSize(2, numSamples, true);
+        signals.push_back(std::move(signal));
+    }
+}
+
+// Output audio plus, after every block, the sidechain envelope of every band
+// on both channels.
+struct Rendering
+{
+    juce::AudioBuffer<float> output;
+    std::vector<float> envelopeTrace;
+    int numBands = 0;
+    int numFrames = 0;
+};
+
+static Rendering render(const GoldenSignal& signal, const GoldenPreset& preset, const EngineVariant& engine) {
+    OvocoderAudioProcessor processor ({ OvocoderAudioProcessor::maxBands, OvocoderAudioProcessor::maxOrder });
+    for (const auto& parameter : preset.parameters) {
+        auto* ranged = processor.apvts.getParameter(parameter.name.toString());
+        jassert(ranged != nullptr);
+        ranged->setValueNotifyingHost(ranged->convertTo0to1((float) parameter.value));
+    }
+    engine.configure(processor);
+
+    auto layout = processor.getBusesLayout();
+    if (! preset.useUnvoiced)
+        layout.inputBuses.getReference(OvocoderAudioProcessor::unvoicedBusIndex) = juce::AudioChannelSet::disabled();
+    processor.setBusesLayout(layout);
+
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(goldenSampleRate, goldenBlockSize);
+    processor.prepareToPlay(goldenSampleRate, goldenBlockSize);
+
+    const int mainChannel = processor.getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::mainBusIndex, 0);
+    const int sidechainChannel = processor.getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::sidechainBusIndex, 0);
+    const int unvoicedChannel = preset.useUnvoiced ? processor.getChannelIndexInProcessBlockBuffer(true, OvocoderAudioProcessor::unvoicedBusIndex, 0) : -1;
+    const int numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+    const int numSamples = signal.carrier.getNumSamples();
+    Rendering rendering;
+    rendering.output.setSize(2, numSamples);
+    rendering.numBands = processor.getNumBands();
+
+    juce::AudioBuffer<float> buffer (numChannels, goldenBlockSize);
+    juce::MidiBuffer midi;
+    OvocoderAudioProcessor::MeteringFrame frame (processor.getLimits().maxBands);
+    juce::Random noise (0x5eed);
+
+    for (int position = 0; position < numSamples; position += goldenBlockSize) {
+        const int blockSamples = juce::jmin(goldenBlockSize, numSamples - position);
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, blockSamples);
+        block.clear();
+
+        for (int channel = 0; channel < 2; channel++) {
+            block.copyFrom(mainChannel + channel, 0, signal.carrier, channel, position, blockSamples);
+            block.copyFrom(sidechainChannel + channel, 0, signal.modulator, channel, position, blockSamples);
+            if (unvoicedChannel >= 0)
+                for (int sample = 0; sample < blockSamples; sample++)
+                    block.setSample(unvoicedChannel + channel, sample, (noise.nextFloat() * 2.0f - 1.0f) * 0.25f);
+        }
+
+        processor.processBlock(block, midi);
+
+        for (int channel = 0; channel < 2; channel++)
+            rendering.output.copyFrom(channel, position, block, channel, 0, blockSamples);
+
+        processor.getMeteringFrame(frame);
+        for (int channel = 0; channel < 2; channel++)
+            for (int band = 0; band < rendering.numBands; band++)
+                rendering.envelopeTrace.push_back(frame.getEnvelopes(DspStateArena::sidechainFollower, channel)[band]);
+        rendering.numFrames++;
+    }
+
+    return rendering;
+}
+
+static bool writeRendering(const juce::File& directory, const juce::String& caseName, const Rendering& rendering) {
+    const auto audioFile = directory.getChildFile(caseName + ".wav");
+    audioFile.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream (audioFile.createOutputStream());
+    if (stream == nullptr)
+        return false;
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor(stream.get(), goldenSampleRate, 2, 32, {}, 0));
+    if (writer == nullptr)
+        return false;
+    stream.release();
+    if (! writer->writeFromAudioSampleBuffer(rendering.output, 0, rendering.output.getNumSamples()))
+        return false;
+    writer.reset();
+
+    const auto traceFile = directory.getChildFile(caseName + ".trace");
+    traceFile.deleteFile();
+    juce::FileOutputStream traceStream (traceFile);
+    if (traceStream.failedToOpen())
+        return false;
+
+    traceStream.writeInt(traceMagic);
+    traceStream.writeInt(rendering.numBands);
+    traceStream.writeInt(rendering.numFrames);
+    for (float value : rendering.envelopeTrace)
+        traceStream.writeFloat(value);
+    return true;
+}
+
+static bool readRendering(const juce::File& directory, const juce::String& caseName, Rendering& rendering) {
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(directory.getChildFile(caseName + ".wav")));
+    if (reader == nullptr)
+        return false;
+    rendering.output.setSize(2, (int) reader->lengthInSamples);
+    reader->read(&rendering.output, 0, (int) reader->lengthInSamples, 0, true, true);
+
+    juce::FileInputStream traceStream (directory.getChildFile(caseName + ".trace"));
+    if (traceStream.failedToOpen() || traceStream.readInt() != traceMagic)
+        return false;
+
+    rendering.numBands = traceStream.readInt();
+    rendering.numFrames = traceStream.readInt();
+    const auto numValues = (juce::int64) rendering.numFrames * 2 * rendering.numBands;
+    if (numValues < 0 || traceStream.getNumBytesRemaining() != numValues * (juce::int64) sizeof(float))
+        return false;
+
+    rendering.envelopeTrace.resize((size_t) numValues);
+    for (auto& value : rendering.envelopeTrace)
+        value = traceStream.readFloat();
+    return true;
+}
+
+// Error of `actual` relative to `expected` in dB; -inf when identical.
+static double getErrorDb(const float* expected, const float* actual, size_t n) {
+    double errorEnergy = 0.0, referenceEnergy = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const double difference = (double) actual[i] - expected[i];
+        errorEnergy += difference * difference;
+        referenceEnergy += (double) expected[i] * expected[i];
+    }
+    if (errorEnergy == 0.0)
+        return -std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(errorEnergy / juce::jmax(referenceEnergy, 1.0e-20));
+}
+
+static juce::String compare(const Rendering& expected, const Rendering& actual, const EngineVariant& engine) {
+    if (expected.output.getNumSamples() != actual.output.getNumSamples())
+        return "length differs";
+    if (expected.numBands != actual.numBands || expected.numFrames != actual.numFrames)
+        return "envelope trace shape differs";
+
+    if (engine.toleranceDb == 0.0) {
+        for (int channel = 0; channel < 2; channel++) {
+            const auto* a = expected.output.getReadPointer(channel);
+            const auto* b = actual.output.getReadPointer(channel);
+            for (int sample = 0; sample < expected.output.getNumSamples(); sample++)
+                if (std::memcmp(a + sample, b + sample, sizeof(float)) != 0)
+                    return "output differs at channel " + juce::String(channel) + ", sample " + juce::String(sample);
+        }
+        if (std::memcmp(expected.envelopeTrace.data(), actual.envelopeTrace.data(), expected.envelopeTrace.size() * sizeof(float)) != 0)
+            return "envelope trace differs";
+        return {};
+    }
+
+    for (int channel = 0; channel < 2; channel++) {
+        const double errorDb = getErrorDb(expected.output.getReadPointer(channel), actual.output.getReadPointer(channel), (size_t) expected.output.getNumSamples());
+        if (errorDb > -engine.toleranceDb)
+            return "output error " + juce::String(errorDb, 1) + " dB on channel " + juce::String(channel);
+    }
+
+    // Envelopes are checked band by band so a single misbehaving band is not
+    // hidden by the loud ones.
+    const int stride = 2 * expected.numBands;
+    for (int lane = 0; lane < stride; lane++) {
+        std::vector<float> a, b;
+        for (int frame = 0; frame < expected.numFrames; frame++) {
+            a.push_back(expected.envelopeTrace[(size_t) (frame * stride + lane)]);
+            b.push_back(actual.envelopeTrace[(size_t) (frame * stride + lane)]);
+        }
+        const double errorDb = getErrorDb(a.data(), b.data(), a.size());
+        if (errorDb > -engine.toleranceDb)
+            return "envelope error " + juce::String(errorDb, 1) + " dB in band " + juce::String(lane % expected.numBands)
+                 + " of channel " + juce::String(lane / expected.numBands);
+    }
+    return {};
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    if (! args.containsOption("--golden")) {
+        std::cerr << "Usage: " << args.executableName << " --golden=<dir> [--record] [--recordings=<dir>] [--engines=reference,...]" << std::endl;
+        return 1;
+    }
+
+    const auto goldenDirectory = args.getFileForOption("--golden");
+    const bool record = args.containsOption("--record");
+
+    auto signals = makeSyntheticSignals();
+    if (args.containsOption("--recordings"))
+        addRecordings(signals, args.getExistingFolderForOption("--recordings"));
+
+    std::vector<EngineVariant> engines;
+    const auto requestedEngines = juce::StringArray::fromTokens(args.containsOption("--engines") ? args.getValueForOption("--engines") : juce::String("reference"), ",", "");
+    for (const auto& engine : getEngineVariants())
+        if (requestedEngines.contains(engine.name))
+            engines.push_back(engine);
+
+    if (engines.empty()) {
+        std::cerr << "No known engine in " << requestedEngines.joinIntoString(",") << std::endl;
+        return 1;
+    }
+
+    if (record) {
+        goldenDirectory.createDirectory();
+        const auto& reference = getEngineVariants().front();
+        for (const auto& preset : getPresets()) {
+            for (const auto& signal : signals) {
+                const auto caseName = preset.name + "_" + signal.name;
+                if (! writeRendering(goldenDirectory, caseName, render(signal, preset, reference))) {
+                    std::cerr << "Could not write " << caseName << " to " << goldenDirectory.getFullPathName() << std::endl;
+                    return 1;
+                }
+                std::cout << "recorded " << caseName << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    int failures = 0, checks = 0;
+    for (const auto& engine : engines) {
+        for (const auto& preset : getPresets()) {
+            for (const auto& signal : signals) {
+                const auto caseName = preset.name + "_" + signal.name;
+                checks++;
+
+                Rendering expected;
+                if (! readRendering(goldenDirectory, caseName, expected)) {
+                    std::cout << "MISSING " << engine.name << " " << caseName << std::endl;
+                    failures++;
+                    continue;
+                }
+
+                const auto error = compare(expected, render(signal, preset, engine), engine);
+                if (error.isNotEmpty()) {
+                    std::cout << "FAIL " << engine.name << " " << caseName << ": " << error << std::endl;
+                    failures++;
+                } else {
+                    std::cout << "ok   " << engine.name << " " << caseName << std::endl;
+                }
+            }
+        }
+    }
+
+    std::cout << (checks - failures) << "/" << checks << " cases match" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Tails the shared-memory metrics published by running Ovocoder instances
+    (see MetricsPublisher.h).
+
+    Usage:
+        OvocoderMetricsReader [--segment=/ovocoder-metrics] [--interval=ms] [--once]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/MetricsPublisher.h"
+
+static juce::String column(const juce::String& text, int width) {
+    return text.paddedLeft(' ', width);
+}
+
+static void printTable(const OvocoderMetrics::Segment& segment) {
+    std::cout << column("pid", 8) << column("inst", 6) << column("blocks", 12) << column("avg ms", 9)
+              << column("max ms", 9) << column("last ms", 9) << column("load %", 8) << column("overruns", 10)
+              << column("rate", 8) << column("block", 7) << column("bands", 7) << column("order", 7) << column("detector", 10) << std::endl;
+
+    int numLive = 0;
+    for (const auto& slot : segment.slots) {
+        const auto pid = slot.ownerPid.load();
+        if (pid == 0 || ! OvocoderMetrics::isProcessAlive(pid))
+            continue;
+
+        OvocoderMetrics::InstanceMetrics metrics;
+        if (! slot.metrics.tryRead(metrics) && ! slot.metrics.tryRead(metrics))
+            continue;
+
+        const double averageSeconds = metrics.blocksProcessed > 0 ? metrics.totalProcessSeconds / (double) metrics.blocksProcessed : 0.0;
+        const double deadlineSeconds = metrics.sampleRate > 0.0 ? metrics.blockSize / metrics.sampleRate : 0.0;
+        const double load = deadlineSeconds > 0.0 ? averageSeconds / deadlineSeconds : 0.0;
+
+        std::cout << column(juce::String(pid), 8) << column(juce::String(slot.instanceId), 6)
+                  << column(juce::String((juce::int64) metrics.blocksProcessed), 12)
+                  << column(juce::String(averageSeconds * 1000.0, 3), 9)
+                  << column(juce::String(metrics.maxProcessSeconds * 1000.0, 3), 9)
+                  << column(juce::String(metrics.lastProcessSeconds * 1000.0, 3), 9)
+                  << column(juce::String(load * 100.0, 1), 8)
+                  << column(juce::String((juce::int64) metrics.deadlineOverruns), 10)
+                  << column(juce::String((int) metrics.sampleRate), 8) << column(juce::String(metrics.blockSize), 7)
+                  << column(juce::String(metrics.numBands), 7) << column(juce::String(metrics.order), 7)
+                  << column(metrics.correlationEnabled != 0 ? "on" : "off", 10) << std::endl;
+        numLive++;
+    }
+
+    std::cout << numLive << " live instance" << (numLive == 1 ? "" : "s") << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    const auto segmentName = args.containsOption("--segment") ? args.getValueForOption("--segment") : juce::String(OvocoderMetrics::defaultSegmentName);
+    const int interval = args.containsOption("--interval") ? juce::jmax(50, args.getValueForOption("--interval").getIntValue()) : 1000;
+
+    auto* segment = OvocoderMetrics::mapSegment(segmentName, false);
+    if (segment == nullptr) {
+        std::cerr << "No metrics segment " << segmentName << "; start the instances with OVOCODER_METRICS set" << std::endl;
+        return 1;
+    }
+
+    for (;;) {
+        printTable(*segment);
+        if (args.containsOption("--once"))
+            break;
+        std::cout << std::endl;
+        juce::Thread::sleep(interval);
+    }
+
+    OvocoderMetrics::unmapSegment(segment);
+    return 0;
+}
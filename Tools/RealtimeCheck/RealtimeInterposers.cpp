@@ -0,0 +1,253 @@
+/*
+  ==============================================================================
+
+    RealtimeInterposers.cpp
+    Replacements for the allocator, pthread locking and blocking system
+    calls that report to RealtimeGuard when called from a real-time
+    section. Link this into a tool executable (never into the plugin) to
+    check the audio path. glibc only: allocation forwards to the
+    __libc_* entry points, everything else to the next definition found
+    through dlsym.
+
+  ==============================================================================
+*/
+
+#include "../../Source/RealtimeGuard.h"
+
+#if JUCE_LINUX
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <new>
+#include <cstdarg>
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void  __libc_free(void*);
+    void* __libc_memalign(size_t, size_t);
+}
+
+static inline void check(const char* kind) noexcept {
+    if (RealtimeGuard::isActive())
+        RealtimeGuard::reportViolation(kind);
+}
+
+template <typename Function>
+static Function next(const char* name) noexcept {
+    return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+//==============================================================================
+extern "C"
+{
+    void* malloc(size_t size) {
+        check("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        check("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        check("realloc");
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer) {
+        if (pointer != nullptr)
+            check("free");
+        __libc_free(pointer);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size) {
+        check("posix_memalign");
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) {
+        check("aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+}
+
+//==============================================================================
+void* operator new(size_t size) {
+    check("operator new");
+    if (void* pointer = __libc_malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    check("operator new[]");
+    if (void* pointer = __libc_malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    check("operator new");
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    check("operator new[]");
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer != nullptr)
+        check("operator delete");
+    __libc_free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    if (pointer != nullptr)
+        check("operator delete[]");
+    __libc_free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { operator delete[](pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { operator delete[](pointer); }
+
+//==============================================================================
+// Types declared with alignas beyond the default new alignment, in the
+// plugin or in the standard library and JUCE, allocate through these.
+void* operator new(size_t size, std::align_val_t alignment) {
+    check("operator new");
+    if (void* pointer = __libc_memalign((size_t) alignment, size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    check("operator new[]");
+    if (void* pointer = __libc_memalign((size_t) alignment, size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    check("operator new");
+    return __libc_memalign((size_t) alignment, size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    check("operator new[]");
+    return __libc_memalign((size_t) alignment, size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { operator delete[](pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { operator delete[](pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { operator delete[](pointer); }
+
+//==============================================================================
+extern "C"
+{
+    int pthread_mutex_lock(pthread_mutex_t* mutex) {
+        static auto real = next<int (*)(pthread_mutex_t*)>("pthread_mutex_lock");
+        static auto tryLock = next<int (*)(pthread_mutex_t*)>("pthread_mutex_trylock");
+        if (RealtimeGuard::isActive() && RealtimeGuard::uncontendedLocksAllowed() && tryLock(mutex) == 0)
+            return 0;
+        check("pthread_mutex_lock");
+        return real(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* lock) {
+        static auto real = next<int (*)(pthread_rwlock_t*)>("pthread_rwlock_rdlock");
+        check("pthread_rwlock_rdlock");
+        return real(lock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* lock) {
+        static auto real = next<int (*)(pthread_rwlock_t*)>("pthread_rwlock_wrlock");
+        check("pthread_rwlock_wrlock");
+        return real(lock);
+    }
+
+    int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex) {
+        static auto real = next<int (*)(pthread_cond_t*, pthread_mutex_t*)>("pthread_cond_wait");
+        check("pthread_cond_wait");
+        return real(condition, mutex);
+    }
+
+    int pthread_cond_timedwait(pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time) {
+        static auto real = next<int (*)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*)>("pthread_cond_timedwait");
+        check("pthread_cond_timedwait");
+        return real(condition, mutex, time);
+    }
+
+    int sem_wait(sem_t* semaphore) {
+        static auto real = next<int (*)(sem_t*)>("sem_wait");
+        check("sem_wait");
+        return real(semaphore);
+    }
+
+    //==============================================================================
+    int nanosleep(const struct timespec* request, struct timespec* remaining) {
+        static auto real = next<int (*)(const struct timespec*, struct timespec*)>("nanosleep");
+        check("nanosleep");
+        return real(request, remaining);
+    }
+
+    int usleep(useconds_t microseconds) {
+        static auto real = next<int (*)(useconds_t)>("usleep");
+        check("usleep");
+        return real(microseconds);
+    }
+
+    int poll(struct pollfd* fds, nfds_t numFds, int timeout) {
+        static auto real = next<int (*)(struct pollfd*, nfds_t, int)>("poll");
+        check("poll");
+        return real(fds, numFds, timeout);
+    }
+
+    ssize_t read(int fd, void* buffer, size_t count) {
+        static auto real = next<ssize_t (*)(int, void*, size_t)>("read");
+        check("read");
+        return real(fd, buffer, count);
+    }
+
+    ssize_t write(int fd, const void* buffer, size_t count) {
+        static auto real = next<ssize_t (*)(int, const void*, size_t)>("write");
+        check("write");
+        return real(fd, buffer, count);
+    }
+
+    int open(const char* path, int flags, ...) {
+        static auto real = next<int (*)(const char*, int, ...)>("open");
+        check("open");
+        mode_t mode = 0;
+        if ((flags & O_CREAT) != 0) {
+            va_list args;
+            va_start(args, flags);
+            mode = (mode_t) va_arg(args, int);
+            va_end(args);
+        }
+        return real(path, flags, mode);
+    }
+
+    int close(int fd) {
+        static auto real = next<int (*)(int)>("close");
+        check("close");
+        return real(fd);
+    }
+}
+
+#endif
@@ -0,0 +1,307 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Host simulation stress harness: drives OvocoderAudioProcessor headlessly
+    through a set of bus layouts and block size patterns while automating
+    parameters, and reports per-block processing time against the real-time
+    deadline.
+
+    Usage:
+        OvocoderStressHarness [--sample-rate=48000] [--block-size=512]
+                              [--seconds=10] [--seed=N]
+                              [--automation=none|block|thread|host|both]
+                              [--layouts=full,no_unvoiced,no_sidechain]
+                              [--patterns=fixed,random]
+                              [--trace=<file.json>]
+
+    Links the RealtimeCheck interposers: in builds with OVOCODER_RT_CHECKS
+    every allocation, lock or blocking call made inside processBlock is
+    reported with a backtrace. --automation=host delivers the parameter
+    changes inside that section too, on the audio thread right before
+    processBlock, the way a VST3 host hands them over with each process call.
+    JUCE's listener lock on that path is the wrapper's, not the plugin's, so
+    it is only reported when contended.
+
+    Returns 1 when any block missed its deadline, 2 when the audio path
+    was not real-time safe.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/RealtimeGuard.h"
+
+struct Scenario
+{
+    juce::String layout;
+    juce::String pattern;
+};
+
+struct ScenarioResult
+{
+    Scenario scenario;
+    int numBlocks = 0;
+    int deadlineMisses = 0;
+    double p50 = 0.0, p99 = 0.0, p999 = 0.0, max = 0.0;     // microseconds
+    double loadP50 = 0.0, loadP99 = 0.0, loadMax = 0.0;     // fraction of the block deadline
+    std::array<int, 6> loadHistogram {};
+};
+
+// Upper edges of the load histogram buckets, as a fraction of the deadline.
+static const std::array<double, 5> loadBucketEdges { 0.1, 0.25, 0.5, 0.75, 1.0 };
+
+static double percentile(std::vector<double> values, double fraction) {
+    if (values.empty())
+        return 0.0;
+    const auto index = (size_t) juce::jlimit(0.0, (double) values.size() - 1.0, std::ceil(fraction * values.size()) - 1.0);
+    std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t) index, values.end());
+    return values[index];
+}
+
+// Sweeps or jumps a random parameter, the way a host replaying dense
+// automation (or a user dragging several controls) would.
+class ParameterAutomator
+{
+public:
+    ParameterAutomator(OvocoderAudioProcessor& processor, juce::int64 seed)
+        : random(seed) {
+        for (auto* parameter : processor.getParameters())
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+                parameters.add(ranged);
+    }
+
+    // Delivers the change the way JUCE's VST3 wrapper does from inside
+    // process(): set the value, then call the listeners on this thread,
+    // without the host round trip.
+    void step(bool fromAudioThread = false) {
+        if (parameters.isEmpty())
+            return;
+
+        auto* parameter = parameters[random.nextInt(parameters.size())];
+        const float current = parameter->getValue();
+        const float target = random.nextInt(8) == 0 ? random.nextFloat()
+                                                    : juce::jlimit(0.0f, 1.0f, current + (random.nextFloat() - 0.5f) * 0.1f);
+        if (fromAudioThread) {
+            parameter->setValue(target);
+            parameter->sendValueChangedMessageToListeners(target);
+        } else {
+            parameter->setValueNotifyingHost(target);
+        }
+    }
+
+private:
+    juce::Random random;
+    juce::Array<juce::RangedAudioParameter*> parameters;
+};
+
+class AutomationThread : public juce::Thread
+{
+public:
+    AutomationThread(OvocoderAudioProcessor& processor, juce::int64 seed)
+        : juce::Thread("Automation"), automator(processor, seed) {}
+
+    void run() override {
+        while (! threadShouldExit()) {
+            automator.step();
+            juce::Thread::sleep(1);
+        }
+    }
+
+private:
+    ParameterAutomator automator;
+};
+
+static bool applyLayout(OvocoderAudioProcessor& processor, const juce::String& layoutName) {
+    auto layout = processor.getBusesLayout();
+    for (auto& bus : layout.inputBuses)
+        bus = juce::AudioChannelSet::stereo();
+
+    if (layoutName == "no_unvoiced")
+        layout.inputBuses.getReference(OvocoderAudioProcessor::unvoicedBusIndex) = juce::AudioChannelSet::disabled();
+    else if (layoutName == "no_sidechain")
+        layout.inputBuses.getReference(OvocoderAudioProcessor::sidechainBusIndex) = juce::AudioChannelSet::disabled();
+    else if (layoutName != "full")
+        return false;
+
+    return processor.setBusesLayout(layout);
+}
+
+static void fillInputs(juce::AudioBuffer<float>& buffer, int numSamples, double sampleRate, double& phase, juce::Random& random) {
+    // A saw carrier on every channel and noise bursts on top, so both the
+    // filterbank and the correlation detector have something to chew on.
+    const double increment = 110.0 / sampleRate;
+    for (int sample = 0; sample < numSamples; sample++) {
+        const float saw = (float) (2.0 * phase - 1.0);
+        phase += increment;
+        if (phase >= 1.0)
+            phase -= 1.0;
+        for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+            buffer.setSample(channel, sample, channel % 2 == 0 ? saw * 0.5f : (random.nextFloat() - 0.5f) * 0.5f);
+    }
+}
+
+static ScenarioResult runScenario(const Scenario& scenario, double sampleRate, int maxBlockSize, double seconds,
+                                  const juce::String& automation, juce::int64 seed, const juce::File& traceFile) {
+    ScenarioResult result;
+    result.scenario = scenario;
+
+    OvocoderAudioProcessor processor;
+    if (! applyLayout(processor, scenario.layout)) {
+        std::cerr << "Layout " << scenario.layout << " was rejected by the processor" << std::endl;
+        return result;
+    }
+
+    processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+    processor.prepareToPlay(sampleRate, maxBlockSize);
+
+    if (traceFile != juce::File())
+        processor.getTraceRecorder().start(traceFile.getSiblingFile(traceFile.getFileNameWithoutExtension() + "_" + scenario.layout + "_" + scenario.pattern)
+                                                   .withFileExtension(traceFile.getFileExtension()));
+
+    const int numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+    juce::AudioBuffer<float> buffer (numChannels, maxBlockSize);
+    juce::MidiBuffer midi;
+
+    juce::Random random (seed);
+    ParameterAutomator automator (processor, seed + 1);
+    AutomationThread automationThread (processor, seed + 2);
+    if (automation == "thread" || automation == "both")
+        automationThread.startThread();
+    const bool automateBlocks = automation == "block" || automation == "both";
+    const bool automateInHost = automation == "host";
+
+    std::vector<double> latencies, loads;
+    double phase = 0.0;
+    const juce::int64 totalSamples = (juce::int64) (seconds * sampleRate);
+
+    for (juce::int64 position = 0; position < totalSamples;) {
+        const int numSamples = scenario.pattern == "random" ? 1 + random.nextInt(maxBlockSize) : maxBlockSize;
+
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+        fillInputs(block, numSamples, sampleRate, phase, random);
+
+        if (automateBlocks)
+            for (int i = random.nextInt(4); --i >= 0;)
+                automator.step();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        {
+            // The host's own process call: its parameter delivery counts
+            // against the block and against real-time safety.
+            RealtimeGuard::ScopedSection hostSection;
+            if (automateInHost) {
+                RealtimeGuard::ScopedUncontendedLocksAllowed wrapperListenerLock;
+                for (int i = random.nextInt(4); --i >= 0;)
+                    automator.step(true);
+            }
+            processor.processBlock(block, midi);
+        }
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        const double deadline = numSamples / sampleRate;
+        const double load = elapsed / deadline;
+        latencies.push_back(elapsed * 1.0e6);
+        loads.push_back(load);
+
+        int bucket = 0;
+        while (bucket < (int) loadBucketEdges.size() && load > loadBucketEdges[(size_t) bucket])
+            bucket++;
+        result.loadHistogram[(size_t) bucket]++;
+
+        if (load > 1.0)
+            result.deadlineMisses++;
+
+        position += numSamples;
+    }
+
+    automationThread.stopThread(1000);
+    processor.getTraceRecorder().stop();
+    processor.releaseResources();
+
+    result.numBlocks = (int) latencies.size();
+    result.p50 = percentile(latencies, 0.5);
+    result.p99 = percentile(latencies, 0.99);
+    result.p999 = percentile(latencies, 0.999);
+    result.max = percentile(latencies, 1.0);
+    result.loadP50 = percentile(loads, 0.5);
+    result.loadP99 = percentile(loads, 0.99);
+    result.loadMax = percentile(loads, 1.0);
+    return result;
+}
+
+static void printResult(const ScenarioResult& result) {
+    std::cout << result.scenario.layout << " / " << result.scenario.pattern << ": "
+              << result.numBlocks << " blocks, " << result.deadlineMisses << " deadline misses" << std::endl;
+    std::cout << "    latency us   p50 " << juce::String(result.p50, 1)
+              << "  p99 " << juce::String(result.p99, 1)
+              << "  p99.9 " << juce::String(result.p999, 1)
+              << "  max " << juce::String(result.max, 1) << std::endl;
+    std::cout << "    deadline %   p50 " << juce::String(result.loadP50 * 100.0, 1)
+              << "  p99 " << juce::String(result.loadP99 * 100.0, 1)
+              << "  max " << juce::String(result.loadMax * 100.0, 1) << std::endl;
+
+    std::cout << "    histogram   ";
+    double lowerEdge = 0.0;
+    for (size_t bucket = 0; bucket < result.loadHistogram.size(); bucket++) {
+        const auto label = bucket < loadBucketEdges.size()
+                             ? juce::String(juce::roundToInt(lowerEdge * 100.0)) + "-" + juce::String(juce::roundToInt(loadBucketEdges[bucket] * 100.0)) + "%"
+                             : juce::String(">100%");
+        std::cout << " " << label << ": " << result.loadHistogram[bucket];
+        if (bucket < loadBucketEdges.size())
+            lowerEdge = loadBucketEdges[bucket];
+    }
+    std::cout << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    auto option = [&args] (const char* name, const juce::String& fallback) {
+        return args.containsOption(name) ? args.getValueForOption(name) : fallback;
+    };
+
+    const double sampleRate = option("--sample-rate", "48000").getDoubleValue();
+    const int blockSize = juce::jmax(1, option("--block-size", "512").getIntValue());
+    const double seconds = juce::jmax(0.1, option("--seconds", "10").getDoubleValue());
+    const auto seed = (juce::int64) option("--seed", "1").getLargeIntValue();
+    const auto automation = option("--automation", "block");
+    const auto layouts = juce::StringArray::fromTokens(option("--layouts", "full,no_unvoiced,no_sidechain"), ",", "");
+    const auto patterns = juce::StringArray::fromTokens(option("--patterns", "fixed,random"), ",", "");
+    const auto traceFile = args.containsOption("--trace") ? args.getFileForOption("--trace") : juce::File();
+
+    std::cout << "Sample rate " << sampleRate << ", max block " << blockSize
+              << " (" << juce::String(blockSize / sampleRate * 1000.0, 2) << " ms deadline), automation " << automation << std::endl;
+
+    RealtimeGuard::initialise();
+
+    int totalMisses = 0;
+    bool realtimeViolationsFound = false;
+    for (const auto& layout : layouts) {
+        for (const auto& pattern : patterns) {
+            auto result = runScenario({ layout, pattern }, sampleRate, blockSize, seconds, automation, seed, traceFile);
+            printResult(result);
+            totalMisses += result.deadlineMisses;
+
+            if (RealtimeGuard::getNumViolations() > 0) {
+                std::cout << "    " << RealtimeGuard::getNumViolations() << " real-time safety violations" << std::endl;
+                if (! realtimeViolationsFound)
+                    RealtimeGuard::printViolations(std::cout);
+                realtimeViolationsFound = true;
+                RealtimeGuard::clearViolations();
+            }
+        }
+    }
+
+   #if ! OVOCODER_RT_CHECKS
+    std::cout << "Real-time safety checks are not compiled into this build" << std::endl;
+   #endif
+
+    if (realtimeViolationsFound)
+        return 2;
+    return totalMisses > 0 ? 1 : 0;
+}